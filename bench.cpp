@@ -0,0 +1,205 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <string>
+
+#include "bench.h"
+#include "position.h"
+#include "search.h"
+#include "movegen.h"
+#include "io.h"
+#include "perf.h"
+
+namespace bench
+{
+    //Openings, middle games and endings with a few tactical positions. Keep the list fixed, the signature depends on it
+    const char *BENCH_POSITIONS[] = {
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 10",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 11",
+        "4rrk1/pp1n3p/3q2pQ/2p1pb2/2PP4/2P3N1/P2B2PP/4RRK1 b - - 7 19",
+        "rq3rk1/ppp2ppp/1bnpb3/3N2B1/3NP3/7P/PPPQ1PP1/2KR3R w - - 7 14",
+        "r1bq1r1k/1pp1n1pp/1p1p4/4p2Q/4Pp2/1BNP4/PPP2PPP/3R1RK1 w - - 2 14",
+        "r3r1k1/2p2ppp/p1p1bn2/8/1q2P3/2NPQN2/PPP3PP/R4RK1 b - - 2 15",
+        "r1bbk1nr/pp3p1p/2n5/1N4p1/2Np1B2/8/PPP2PPP/2KR1B1R w kq - 0 13",
+        "r1bq1rk1/ppp1nppp/4n3/3p3Q/3P4/1BP1B3/PP1N2PP/R4RK1 w - - 1 16",
+        "4r1k1/r1q2ppp/ppp2n2/4P3/5Rb1/1N1BQ3/PPP3PP/R5K1 w - - 1 17",
+        "2rqkb1r/ppp2p2/2npb1p1/1N1Nn2p/2P1PP2/8/PP2B1PP/R1BQK2R b KQ - 0 11",
+        "r1bq1r1k/b1p1npp1/p2p3p/1p6/3PP3/1B2NN2/PP3PPP/R2Q1RK1 w - - 1 16",
+        "3r1rk1/p5pp/bpp1pp2/8/q1PP1P2/b3P3/P2NQRPP/1R2B1K1 b - - 6 22",
+        "r1q2rk1/2p1bppp/2Pp4/p6b/Q1PNp3/4B3/PP1R1PPP/2K4R w - - 2 18",
+        "4k2r/1pb2ppp/1p2p3/1R1p4/3P4/2r1PN2/P4PPP/1R4K1 b - - 3 22",
+        "3q2k1/pb3p1p/4pbp1/2r5/PpN2N2/1P2P2P/5PP1/Q2R2K1 b - - 4 26",
+        "r1bqkb1r/pppp1ppp/2n2n2/4p3/2B1P3/5N2/PPPP1PPP/RNBQK2R w KQkq - 4 4",
+        "r2q1rk1/pp2bppp/2n1pn2/3p4/2PP4/2N1PN2/PP2BPPP/R2Q1RK1 w - - 0 9",
+        "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+        "r1bq1rk1/pp3ppp/2nbpn2/3p4/3P4/2PBPN2/PP1N1PPP/R1BQ1RK1 b - - 0 9",
+        "r3k2r/2pb1ppp/2pp1q2/p7/1nP1B3/1P2P3/P2N1PPP/R2QK2R w KQkq a6 0 14",
+        "4rrk1/2p1b1p1/p1p3q1/4p3/2P2n1p/1P1NR2P/PB3PP1/3R1QK1 b - - 2 24",
+        "r3qbrk/6p1/2b2pPp/p3pP1Q/PpPpP2P/3P1B2/2PB3K/R5R1 w - - 16 42",
+        "6k1/1R3p2/6p1/2Bp3p/3P2q1/P7/1P2rQ1K/5R2 b - - 4 44",
+        "7r/2p3k1/1p1p1qp1/1P1Bp3/p1P2r1P/P7/4R3/Q4RK1 w - - 0 36",
+        "r1bq1rk1/pp2b1pp/n1pp1n2/3P1p2/2P1p3/2N1P2N/PP2BPPP/R1BQ1RK1 b - - 2 10",
+        "3r3k/2r4p/1p1b3q/p4P2/P2Pp3/1B2P3/3BQ1RP/6K1 w - - 3 87",
+        "2r4r/1p4k1/1Pnp4/3Qb1pq/8/4BpPp/5P2/2RR1BK1 w - - 0 42",
+        "4q1bk/6b1/7p/p1p4p/PNPpP2P/KN4P1/3Q4/4R3 b - - 0 37",
+        "2q3r1/1r2pk2/pp3pp1/2pP3p/P1Pb1BbP/1P4Q1/R3NPP1/4R1K1 w - - 2 34",
+        "1r2r2k/1b4q1/pp5p/2pPp1p1/P3Pn2/1P1B1Q1P/2R3P1/4BR1K b - - 1 37",
+        "5rk1/q6p/2p3bR/1pPp1rP1/1P1Pp3/P3B1Q1/1K3P2/R7 w - - 93 90",
+        "4rrk1/1p1nq3/p7/2p1P1pp/3P2bp/3Q1Bn1/PPPB4/1K2R1NR w - - 40 21",
+        "r3k2r/3nnpbp/q2pp1p1/p7/Pp1PPPP1/4BNN1/1P5P/R2Q1RK1 w kq - 0 16",
+        "3Qb1k1/1r2ppb1/pN1n2q1/Pp1Pp1Pr/4P2p/4BP2/4B1R1/1R5K b - - 11 40",
+        "6k1/3b3r/1p1p4/p1n2p2/1PPNpP1q/P3Q1p1/1R1RB1P1/5K2 b - - 0 1",
+        "r2r1n2/pp2bk2/2p1p2p/3q4/3PN1QP/2P3R1/P4PP1/5RK1 w - - 0 1",
+        "2rr3k/pp3pp1/1nnqbN1p/3pN3/2pP4/2P3Q1/PPB4P/R4RK1 w - - 0 1",
+        "6k1/6p1/6Pp/ppp5/3pn2P/1P3K2/1PP2P2/3N4 b - - 0 1",
+        "3b4/5kp1/1p1p1p1p/pP1PpP1P/P1P1P3/3KN3/8/8 w - - 0 1",
+        "2K5/p7/7P/5pR1/8/5k2/r7/8 w - - 0 1",
+        "8/6pk/1p6/8/PP3p1p/5P2/4KP1q/3Q4 w - - 0 1",
+        "7k/3p2pp/4q3/8/4Q3/5Kp1/P6b/8 w - - 0 1",
+        "8/2p5/8/2kPKp1p/2p4P/2P5/3P4/8 w - - 0 1",
+        "8/1p3pp1/7p/5P1P/2k3P1/8/2K2P2/8 w - - 0 1",
+        "8/pp2r1k1/2p1p3/3pP2p/1P1P1P1P/P5KR/8/8 w - - 0 1",
+        "8/3p4/p1bk3p/Pp6/1Kp1PpPp/2P2P1P/2P5/5B2 b - - 0 1",
+        "5k2/7R/4P2p/5K2/p1r2P1p/8/8/8 b - - 0 1",
+        "8/8/1p2k1p1/3p3p/1p1P1P1P/1P2PK2/8/8 w - - 3 54",
+        "8/8/3P3k/8/1p6/8/1P6/1K3n2 b - - 0 1",
+    };
+
+    const int NUM_BENCH_POSITIONS = sizeof(BENCH_POSITIONS) / sizeof(BENCH_POSITIONS[0]);
+
+    void run(int hash_mb, int threads, Depth depth)
+    {
+        using namespace std::chrono;
+
+        //The search has one thread, the parameter keeps the command compatible with other engines
+        if(threads != 1)
+            fprintf(stderr, "bench: the search is single threaded, ignoring %i threads\n", threads);
+
+        //The bench must not change the hash size and history of a game in progress
+        suspend_game();
+        set_hash_size(hash_mb);
+
+        long int total_nodes = 0;
+        high_resolution_clock::time_point start = high_resolution_clock::now();
+
+        for(int i = 0; i < NUM_BENCH_POSITIONS; i++)
+        {
+            Position *pos = new Position();
+            std::string fen(BENCH_POSITIONS[i]);
+            pos->init(fen);
+
+            clear_hash();
+            new_game();
+
+            SearchLimits limits = {};
+            limits.depth = depth;
+            limits.soft_time = -1;
+            limits.hard_time = -1;
+            search_controller.start(&limits);
+            do_search(1, pos);
+
+            long int nodes = searched_nodes();
+            total_nodes += nodes;
+            fprintf(stderr, "Position %i/%i: %li nodes\n", i + 1, NUM_BENCH_POSITIONS, nodes);
+
+            delete pos->current_state;
+            delete pos;
+        }
+
+        duration<double, std::milli> elapsed = high_resolution_clock::now() - start;
+        long int ms = (long int) elapsed.count();
+
+        resume_game();
+
+        fprintf(stderr, "===========================\n");
+        fprintf(stderr, "Total time (ms) : %li\n", ms);
+        fprintf(stderr, "Nodes searched  : %li\n", total_nodes);
+        fprintf(stderr, "Nodes/second    : %li\n", 1000 * total_nodes / (ms > 0 ? ms : 1));
+    }
+
+    uint64_t perft(Position *pos, int depth)
+    {
+        if(depth == 0)
+            return 1;
+
+        MoveList moves(pos, false);
+        uint64_t count = 0;
+        for(int i = 0; i < moves.size; i++)
+        {
+            Move move = moves.moveList[i].move;
+            if(!pos->is_legal(move))
+                continue;
+
+            //The leaves need not be made
+            if(depth == 1)
+            {
+                count++;
+                continue;
+            }
+
+            pos->do_move(move);
+            count += perft(pos, depth - 1);
+            pos->undo_move();
+        }
+        return count;
+    }
+
+    void run_perft(Position *pos, int depth)
+    {
+        using namespace std::chrono;
+
+        if(depth < 1)
+            depth = 1;
+
+#ifdef PERF_COUNTERS
+        perf::Counters counters;
+        perf::start(&counters);
+#endif
+        high_resolution_clock::time_point start = high_resolution_clock::now();
+
+        uint64_t total = 0;
+        MoveList moves(pos, false);
+        for(int i = 0; i < moves.size; i++)
+        {
+            Move move = moves.moveList[i].move;
+            if(!pos->is_legal(move))
+                continue;
+
+            pos->do_move(move);
+            uint64_t count = perft(pos, depth - 1);
+            pos->undo_move();
+
+            printf("%s: %llu\n", io::move_to_string(move), (unsigned long long) count);
+            total += count;
+        }
+
+        duration<double, std::milli> elapsed = high_resolution_clock::now() - start;
+#ifdef PERF_COUNTERS
+        perf::stop(&counters);
+#endif
+
+        long int ms = (long int) elapsed.count();
+        printf("\nNodes searched: %llu\nTime (ms): %li\nNodes/second: %llu\n", (unsigned long long) total, ms,
+            (unsigned long long) (1000 * total / (ms > 0 ? ms : 1)));
+#ifdef PERF_COUNTERS
+        perf::report(&counters, "perft", total);
+#endif
+        fflush(stdout);
+    }
+
+    void run(char *args)
+    {
+        int values[3] = { DEFAULT_HASH_MB, DEFAULT_THREADS, DEFAULT_DEPTH };
+        char *token = args != NULL ? strtok(args, " \n") : NULL;
+        for(int i = 0; i < 3 && token != NULL; i++)
+        {
+            values[i] = atoi(token);
+            token = strtok(NULL, " \n");
+        }
+
+        run(values[0] > 0 ? values[0] : DEFAULT_HASH_MB, values[1], values[2] > 0 ? values[2] : DEFAULT_DEPTH);
+    }
+}
@@ -0,0 +1,35 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+
+#include "types.h"
+#include "position.h"
+
+namespace bench
+{
+    //The positions of the bench command, also the corpus of the microbenchmarks
+    extern const char *BENCH_POSITIONS[];
+    extern const int NUM_BENCH_POSITIONS;
+
+    //Defaults of the bench command, the depth is chosen so that the bench runs for a few seconds
+    const int DEFAULT_HASH_MB = 16;
+    const int DEFAULT_THREADS = 1;
+    const Depth DEFAULT_DEPTH = 9;
+
+    //Searches the built-in positions to a fixed depth, each with an empty transposition table and new history.
+    //The total node count is a signature of the search: every change of the search tree changes it.
+    //The search output goes to stdout, the summary to stderr. The table and history of a game in progress are restored afterwards
+    void run(int hash_mb, int threads, Depth depth);
+
+    //Parses "[hash] [threads] [depth]", missing values are the defaults. args may be NULL
+    void run(char *args);
+
+    //Counts the leaf nodes of the legal move tree, used to verify the move generator and to time it
+    uint64_t perft(Position *pos, int depth);
+
+    //Runs perft on the position and prints the count of every root move, the total and the time
+    void run_perft(Position *pos, int depth);
+}
+
+#endif //!BENCH_H
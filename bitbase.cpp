@@ -0,0 +1,282 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <mutex> //std::call_once
+
+#include "bitbase.h"
+#include "bitboards.h"
+
+#ifdef DEBUG
+#include "position.h"
+#include "movegen.h"
+#endif
+
+namespace bitbase
+{
+    //One bit per position, set if the side with the pawn wins (24 KB)
+    uint32_t kpk_bitbase[KPK_MAX_INDEX / 32];
+
+    //Used as bit flags while generating the bitbase
+    enum Result
+    {
+        INVALID = 0, UNKNOWN = 1, DRAW = 2, WIN = 4
+    };
+
+    //The pawn is on the files a-d, its rank is stored as the distance to the 7th rank
+    inline unsigned int kpk_index(Color us, Square weak_king, Square strong_king, Square pawn)
+    {
+        return strong_king | (weak_king << 6) | (us << 12) | ((pawn % 8) << 13) | ((6 - pawn / 8) << 15);
+    }
+
+    inline void decode_kpk_index(unsigned int index, Square *strong_king, Square *weak_king, Color *us, Square *pawn)
+    {
+        *strong_king = (Square)(index & 0x3F);
+        *weak_king = (Square)((index >> 6) & 0x3F);
+        *us = (Color)((index >> 12) & 0x1);
+        *pawn = (Square)(8 * (6 - ((index >> 15) & 0x7)) + ((index >> 13) & 0x3));
+    }
+
+    //Classifies a position without looking at its successors
+    Result initial_result(unsigned int index)
+    {
+        Square strong_king, weak_king, pawn;
+        Color us;
+        decode_kpk_index(index, &strong_king, &weak_king, &us, &pawn);
+
+        //Two pieces on the same square or a king that can be captured
+        if(square_distance(strong_king, weak_king) <= 1
+            || strong_king == pawn
+            || weak_king == pawn
+            || (us == white && get_square(pawn_attack_bb(white, pawn), weak_king)))
+            return INVALID;
+
+        //The pawn promotes and cannot be captured
+        Square queening_square = pawn + N;
+        if(us == white
+            && pawn / 8 == 6
+            && strong_king != queening_square
+            && (square_distance(weak_king, queening_square) > 1 || square_distance(strong_king, queening_square) == 1))
+            return WIN;
+
+        //Stalemate, or the weak king captures the pawn
+        if(us == black
+            && (!(king_attack_bb(weak_king) & ~(king_attack_bb(strong_king) | pawn_attack_bb(white, pawn)))
+                || get_square(king_attack_bb(weak_king) & ~king_attack_bb(strong_king), pawn)))
+            return DRAW;
+
+        return UNKNOWN;
+    }
+
+    //Classifies a position by the results of its successors. The side with the pawn needs one winning move,
+    //the weak side needs one drawing move
+    Result classify(unsigned int index, unsigned char *results)
+    {
+        Square strong_king, weak_king, pawn;
+        Color us;
+        decode_kpk_index(index, &strong_king, &weak_king, &us, &pawn);
+
+        Result good = us == white ? WIN : DRAW;
+        Result bad = us == white ? DRAW : WIN;
+
+        //Illegal king moves lead to invalid positions and add nothing
+        int r = INVALID;
+        Bitboard king_moves = king_attack_bb(us == white ? strong_king : weak_king);
+        while(king_moves)
+        {
+            Square to = pop_lsb(&king_moves);
+            r |= us == white ? results[kpk_index(black, weak_king, to, pawn)]
+                             : results[kpk_index(white, to, strong_king, pawn)];
+        }
+
+        if(us == white)
+        {
+            if(pawn / 8 < 6)
+                r |= results[kpk_index(black, weak_king, strong_king, pawn + N)];
+
+            if(pawn / 8 == 1 && pawn + N != strong_king && pawn + N != weak_king)
+                r |= results[kpk_index(black, weak_king, strong_king, pawn + N + N)];
+        }
+
+        return r & good ? good : r & UNKNOWN ? UNKNOWN : bad;
+    }
+
+    //Reads the bitbase, which has to be generated
+    bool lookup_kpk(Square strong_king, Square pawn, Square weak_king, Color us)
+    {
+        //Only the files a-d are stored, mirror the board horizontally otherwise
+        if(pawn % 8 > 3)
+        {
+            strong_king = (Square)(strong_king ^ 7);
+            weak_king = (Square)(weak_king ^ 7);
+            pawn = (Square)(pawn ^ 7);
+        }
+
+        unsigned int index = kpk_index(us, weak_king, strong_king, pawn);
+        return kpk_bitbase[index / 32] & (1u << (index & 31));
+    }
+
+#ifdef DEBUG
+    //Depth limited minimax over the legal moves. Returns 1 if white wins, 0 if it is a draw and -1 if the depth was not enough
+    int brute_force(Position *pos, int depth)
+    {
+        MoveList moves(pos, false);
+        int num_legal_moves = 0;
+        for(int i = 0; i < moves.size; i++)
+            if(pos->is_legal(moves.moveList[i].move))
+                num_legal_moves++;
+
+        if(!num_legal_moves)
+            return pos->color_to_move == black && pos->current_state->in_check ? 1 : 0;
+
+        //The pawn was captured or under-promoted to a minor piece
+        if(!pos->material[WHITE_PAWN] && !pos->material[WHITE_QUEEN] && !pos->material[WHITE_ROOK])
+            return 0;
+
+        //The pawn promoted to a queen or a rook, which the weak king cannot capture
+        if(!pos->material[WHITE_PAWN])
+        {
+            Bitboard promoted = pos->piece_bitboard[WHITE_QUEEN] | pos->piece_bitboard[WHITE_ROOK];
+            Square black_king = lsb(pos->piece_bitboard[BLACK_KING]);
+            if(pos->color_to_move == white || !(king_attack_bb(black_king) & promoted & ~pos->current_state->attack_bitboards[white]))
+                return 1;
+        }
+
+        if(depth == 0)
+            return -1;
+
+        bool undecided = false;
+        for(int i = 0; i < moves.size; i++)
+        {
+            Move move = moves.moveList[i].move;
+            if(!pos->is_legal(move))
+                continue;
+
+            pos->do_move(move);
+            int result = brute_force(pos, depth - 1);
+            pos->undo_move();
+
+            if(pos->color_to_move == white && result == 1)
+                return 1;
+            if(pos->color_to_move == black && result == 0)
+                return 0;
+            if(result == -1)
+                undecided = true;
+        }
+
+        if(undecided)
+            return -1;
+        return pos->color_to_move == white ? 0 : 1;
+    }
+
+    //Compares the bitbase with a brute force search on random positions
+    void verify(unsigned char *results, int samples, int depth)
+    {
+        int decided = 0, mismatches = 0;
+
+        for(int sample = 0; sample < samples; sample++)
+        {
+            unsigned int index = rand() % KPK_MAX_INDEX;
+            if(results[index] == INVALID)
+                continue;
+
+            Square strong_king, weak_king, pawn;
+            Color us;
+            decode_kpk_index(index, &strong_king, &weak_king, &us, &pawn);
+
+            //Write the position as a FEN
+            char fen[128];
+            char board[64];
+            for(int square = 0; square < 64; square++) board[square] = 0;
+            board[strong_king] = 'K';
+            board[weak_king] = 'k';
+            board[pawn] = 'P';
+            char *ptr_char = fen;
+            for(int rank = 7; rank >= 0; rank--)
+            {
+                int empty = 0;
+                for(int file = 0; file < 8; file++)
+                {
+                    char piece = board[8 * rank + file];
+                    if(!piece) { empty++; continue; }
+                    if(empty) *ptr_char++ = '0' + empty;
+                    empty = 0;
+                    *ptr_char++ = piece;
+                }
+                if(empty) *ptr_char++ = '0' + empty;
+                if(rank) *ptr_char++ = '/';
+            }
+            snprintf(ptr_char, sizeof(fen) - (ptr_char - fen), " %c - - 0 1", us == white ? 'w' : 'b');
+
+            Position *pos = new Position();
+            string fen_string(fen);
+            pos->init(fen_string);
+            int result = brute_force(pos, depth);
+            delete pos->current_state;
+            delete pos;
+
+            if(result == -1)
+                continue;
+            decided++;
+
+            bool win = lookup_kpk(strong_king, pawn, weak_king, us);
+            if(win != (result == 1))
+            {
+                mismatches++;
+                printf("KPK bitbase mismatch: %s, bitbase: %s, search: %s\n", fen, win ? "win" : "draw", result ? "win" : "draw");
+            }
+        }
+
+        printf("KPK bitbase verified on %i positions decided by brute force, %i mismatches\n", decided, mismatches);
+    }
+#endif
+
+    void generate()
+    {
+        unsigned char *results = new unsigned char[KPK_MAX_INDEX];
+        for(unsigned int index = 0; index < KPK_MAX_INDEX; index++)
+            results[index] = initial_result(index);
+
+        //Iterate until no position changes its result, the remaining unknown positions are draws
+        bool repeat = true;
+        while(repeat)
+        {
+            repeat = false;
+            for(unsigned int index = 0; index < KPK_MAX_INDEX; index++)
+            {
+                if(results[index] != UNKNOWN)
+                    continue;
+
+                Result result = classify(index, results);
+                if(result != UNKNOWN)
+                {
+                    results[index] = result;
+                    repeat = true;
+                }
+            }
+        }
+
+        for(unsigned int index = 0; index < KPK_MAX_INDEX; index++)
+            if(results[index] == WIN)
+                kpk_bitbase[index / 32] |= 1u << (index & 31);
+
+#ifdef DEBUG
+        verify(results, 500, 4);
+#endif
+
+        delete[] results;
+    }
+
+    std::once_flag kpk_generated;
+
+    void init()
+    {
+        std::call_once(kpk_generated, generate);
+    }
+
+    bool probe_kpk(Square strong_king, Square pawn, Square weak_king, Color us)
+    {
+        init();
+        return lookup_kpk(strong_king, pawn, weak_king, us);
+    }
+}
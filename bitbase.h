@@ -0,0 +1,20 @@
+#ifndef BITBASE_H
+#define BITBASE_H
+
+#include "types.h"
+
+namespace bitbase
+{
+    //2 colors to move, 24 pawn squares (files a-d, ranks 2-7), 64 squares for each king
+    const int KPK_MAX_INDEX = 2 * 24 * 64 * 64;
+
+    //Generate the KPK bitbase by retrograde analysis, bitboards have to be initialized before.
+    //Only the first call generates it, probe_kpk calls it, so only games that reach KPK pay for it
+    void init();
+
+    //Returns true if the side with the pawn wins. The squares are seen from the side with the pawn,
+    //so the pawn moves north. us is the side to move, white meaning the side with the pawn
+    bool probe_kpk(Square strong_king, Square pawn, Square weak_king, Color us);
+}
+
+#endif //!BITBASE_H
@@ -1,21 +1,22 @@
 #include <stdio.h>
+#ifdef DEBUG
+#include <stdlib.h> //rand
+#endif
+
+#ifdef USE_PEXT
+#include <immintrin.h> //_pext_u64
+#endif
 
 #include "bitboards.h"
 #include "magics.h"
 
 
 
-//Precomputed tables used for magic bitboard sliding attacks
-Bitboard rook_attack_table[64][4096];
-Bitboard bishop_attack_table[64][1024];
-
 Bitboard pawn_attack_bitboards[2][64];
 Bitboard king_attack_bitboards[64];
 Bitboard knight_attack_bitboards[64];
 Bitboard file_bitboards[64];
 Bitboard rank_bitboards[64];
-Bitboard bishop_occupancy_bitboards[64];
-Bitboard rook_occupancy_bitboards[64];
 
 //[from][to]
 Bitboard ray_bitboards[64][64];
@@ -38,67 +39,18 @@ Bitboard black_queenside_pawnshield;
 
 int manhattan_distance[64][64];
 
-template<>
-Bitboard shift<N>(Bitboard b)
-{
-    return b << 8;
-}
-
-template<>
-Bitboard shift<S>(Bitboard b)
-{
-    return b >> 8;
-}
-
-template<>
-Bitboard shift<W>(Bitboard b)
-{
-    return (b >> 1) & ~file_bitboards[7];
-}
-
-template<>
-Bitboard shift<E>(Bitboard b)
-{
-    return (b << 1) & ~file_bitboards[0];
-}
-
-template<>
-Bitboard shift<NW>(Bitboard b)
-{
-    return (b << 7) & ~file_bitboards[7];
-}
-
-template<>
-Bitboard shift<NE>(Bitboard b)
-{
-    return (b << 9) & ~file_bitboards[0];
-}
-
-template<>
-Bitboard shift<SW>(Bitboard b)
-{
-    return (b >> 9) & ~file_bitboards[7];
-}
-
-template<>
-Bitboard shift<SE>(Bitboard b)
-{
-    return (b >> 7) & ~file_bitboards[0];
-}
-
-Bitboard get_blockers_from_index(int index, Bitboard mask) {
+constexpr Bitboard get_blockers_from_index(int index, Bitboard mask) {
   Bitboard blockers = 0ull;
-  int bits = popcount(mask);
-  for (int i = 0; i < bits; i++) {
-    int bitPos = pop_lsb(&mask);
+  for (int i = 0; mask; i++) {
     if (index & (1 << i)) {
-      blockers |= (1ull << bitPos);
+      blockers |= mask & (~mask + 1);
     }
+    mask &= mask - 1;
   }
   return blockers;
 }
 
-Bitboard get_rook_attacks_slow(int square, Bitboard blockers)
+constexpr Bitboard get_rook_attacks_slow(int square, Bitboard blockers)
 {
     Bitboard attacks = 0ull;
 
@@ -140,7 +92,7 @@ Bitboard get_rook_attacks_slow(int square, Bitboard blockers)
     return attacks;
 }
 
-Bitboard get_bishop_attacks_slow(int square, Bitboard blockers)
+constexpr Bitboard get_bishop_attacks_slow(int square, Bitboard blockers)
 {
     Bitboard attacks = 0ull;
 
@@ -182,23 +134,145 @@ Bitboard get_bishop_attacks_slow(int square, Bitboard blockers)
     return attacks;
 } 
 
-void init_rook_magic_table() {
+//The blockers that can stop a slider, the edges of the board never block anything
+constexpr Bitboard get_rook_occupancy(int square)
+{
+    Bitboard occupancy = 0ull;
+
+    int rank = square / 8;
+    int file = square % 8;
+
+    for(int i = 1; i < 7; i++)
+    {
+        if(i != rank)
+            set_square(occupancy, 8 * i + file);
+
+        if(i != file)
+            set_square(occupancy, 8 * rank + i);
+    }
+
+    return occupancy;
+}
+
+constexpr Bitboard get_bishop_occupancy(int square)
+{
+    Bitboard occupancy = 0ull;
+
+    int rank = square / 8;
+    int file = square % 8;
+
+    for(int i = 1; i < 7; i++)
+    {
+        if(rank - i > 0 && file - i > 0)
+            set_square(occupancy, 8 * (rank - i) + (file - i));
+
+        if(rank - i > 0 && file + i < 7)
+            set_square(occupancy, 8 * (rank - i) + (file + i));
+
+        if(rank + i < 7 && file - i > 0)
+            set_square(occupancy, 8 * (rank + i) + (file - i));
+
+        if(rank + i < 7 && file + i < 7)
+            set_square(occupancy, 8 * (rank + i) + (file + i));
+    }
+
+    return occupancy;
+}
+
+//Every square takes exactly 2^bits entries of one shared table, 102400 for the rooks and 5248 for the bishops (841 KB)
+const int SLIDER_ATTACK_TABLE_SIZE = 102400 + 5248;
+
+struct SliderAttacks
+{
+    Bitboard rook_occupancy[64];
+    Bitboard bishop_occupancy[64];
+    int rook_offsets[64];
+    int bishop_offsets[64];
+    Bitboard attacks[SLIDER_ATTACK_TABLE_SIZE];
+};
+
+//Index of the blockers in the attacks of a square. PEXT extracts the bits in the same order as
+//get_blockers_from_index deposits them, the magics map the blockers into the same range
+constexpr int rook_magic_index(int square, Bitboard blockers, Bitboard occupancy)
+{
+    return ((blockers & occupancy) * rook_magics[square]) >> rook_index_bits[square];
+}
+
+constexpr int bishop_magic_index(int square, Bitboard blockers, Bitboard occupancy)
+{
+    return ((blockers & occupancy) * bishop_magics[square]) >> bishop_index_bits[square];
+}
+
+//The blockers are enumerated with the carry rippler, which visits the subsets of the occupancy in the order
+//of their PEXT index and keeps the constexpr evaluation cheap
+constexpr SliderAttacks generate_slider_attacks()
+{
+    SliderAttacks table{};
+    int offset = 0;
     for (int square = 0; square < 64; square++) {
+        Bitboard occupancy = get_rook_occupancy(square);
+        table.rook_occupancy[square] = occupancy;
+        table.rook_offsets[square] = offset;
+        Bitboard blockers = 0ull;
         for (int blockerIndex = 0; blockerIndex < (1 << (64 - rook_index_bits[square])); blockerIndex++) {
-            Bitboard blockers = get_blockers_from_index(blockerIndex, rook_occupancy_bitboards[square]);
-            rook_attack_table[square][(blockers * rook_magics[square]) >> rook_index_bits[square]] = get_rook_attacks_slow(square, blockers);
+#ifdef USE_PEXT
+            table.attacks[offset + blockerIndex] = get_rook_attacks_slow(square, blockers);
+#else
+            table.attacks[offset + rook_magic_index(square, blockers, occupancy)] = get_rook_attacks_slow(square, blockers);
+#endif
+            blockers = (blockers - occupancy) & occupancy;
         }
+        offset += 1 << (64 - rook_index_bits[square]);
     }
+    for (int square = 0; square < 64; square++) {
+        Bitboard occupancy = get_bishop_occupancy(square);
+        table.bishop_occupancy[square] = occupancy;
+        table.bishop_offsets[square] = offset;
+        Bitboard blockers = 0ull;
+        for (int blockerIndex = 0; blockerIndex < (1 << (64 - bishop_index_bits[square])); blockerIndex++) {
+#ifdef USE_PEXT
+            table.attacks[offset + blockerIndex] = get_bishop_attacks_slow(square, blockers);
+#else
+            table.attacks[offset + bishop_magic_index(square, blockers, occupancy)] = get_bishop_attacks_slow(square, blockers);
+#endif
+            blockers = (blockers - occupancy) & occupancy;
+        }
+        offset += 1 << (64 - bishop_index_bits[square]);
+    }
+    return table;
 }
 
-void init_bishop_magic_table() {
+//Generated by the compiler, so the sliding attacks cost nothing at startup
+constexpr SliderAttacks slider_attacks = generate_slider_attacks();
+
+#ifdef DEBUG
+//Compares the attack lookups with the slow generators for every blocker subset, with random pieces
+//outside the occupancy masks that must not change the result
+void verify_slider_attacks()
+{
+    int checked = 0, mismatches = 0;
     for (int square = 0; square < 64; square++) {
-        for (int blockerIndex = 0; blockerIndex < (1 << (64 - bishop_index_bits[square])); blockerIndex++) {
-            Bitboard blockers = get_blockers_from_index(blockerIndex, bishop_occupancy_bitboards[square]);
-            bishop_attack_table[square][(blockers * bishop_magics[square]) >> bishop_index_bits[square]] = get_bishop_attacks_slow(square, blockers);
+        for (int blockerIndex = 0; blockerIndex < (1 << popcount(slider_attacks.rook_occupancy[square])); blockerIndex++) {
+            Bitboard noise = ((Bitboard) rand() << 32 | rand()) & ~slider_attacks.rook_occupancy[square] & ~(1ull << square);
+            Bitboard blockers = get_blockers_from_index(blockerIndex, slider_attacks.rook_occupancy[square]) | noise;
+            mismatches += rook_attack_bb((Square) square, blockers) != get_rook_attacks_slow(square, blockers);
+            checked++;
+        }
+        for (int blockerIndex = 0; blockerIndex < (1 << popcount(slider_attacks.bishop_occupancy[square])); blockerIndex++) {
+            Bitboard noise = ((Bitboard) rand() << 32 | rand()) & ~slider_attacks.bishop_occupancy[square] & ~(1ull << square);
+            Bitboard blockers = get_blockers_from_index(blockerIndex, slider_attacks.bishop_occupancy[square]) | noise;
+            mismatches += bishop_attack_bb((Square) square, blockers) != get_bishop_attacks_slow(square, blockers);
+            checked++;
         }
     }
+
+#ifdef USE_PEXT
+    printf("PEXT slider attacks verified on %i blocker sets, %i mismatches\n", checked, mismatches);
+#else
+    printf("Magic slider attacks verified on %i blocker sets, %i mismatches\n", checked, mismatches);
+#endif
 }
+#endif
 
 void init_bitboards()
 {
@@ -221,9 +295,6 @@ void init_bitboards()
 
     for(int square = 0; square < 64; square++)
     {
-        int rank = square / 8;
-        int file = square % 8;
-
         Bitboard square_bb = 1ull << square;
 
         //King attack bitboards
@@ -249,36 +320,11 @@ void init_bitboards()
                                         | shift<S>(shift<SE>(square_bb))
                                         | shift<E>(shift<SE>(square_bb))
                                         | shift<E>(shift<NE>(square_bb));
-        
-        //Rook occupancy bitboards
-        for(int i = 1; i < 7; i++)
-        {
-            if(i != rank)
-                set_square(rook_occupancy_bitboards[square], 8 * i + file);
-
-            if(i != file)
-                set_square(rook_occupancy_bitboards[square], 8 * rank + i);
-        }
-
-        //Bishop occupancy bitboards
-        for(int i = 1; i < 7; i++)
-        {
-            if(rank - i > 0 && file - i > 0)
-                set_square(bishop_occupancy_bitboards[square], 8 * (rank - i) + (file - i));
-
-            if(rank - i > 0 && file + i < 7)
-                set_square(bishop_occupancy_bitboards[square], 8 * (rank - i) + (file + i));
-
-            if(rank + i < 7 && file - i > 0)
-                set_square(bishop_occupancy_bitboards[square], 8 * (rank + i) + (file - i));
-
-            if(rank + i < 7 && file + i < 7)
-                set_square(bishop_occupancy_bitboards[square], 8 * (rank + i) + (file + i));
-        }
     }
 
-    init_rook_magic_table();
-    init_bishop_magic_table();
+#ifdef DEBUG
+    verify_slider_attacks();
+#endif
 
     //ray bitboards
     for(int from = 0; from < 64; from++)
@@ -432,16 +478,22 @@ void init_bitboards()
 
 Bitboard bishop_attack_bb(Square s, Bitboard blockers)
 {
-    blockers &= bishop_occupancy_bitboards[s];
-    Bitboard key = (blockers * bishop_magics[s]) >> bishop_index_bits[s];
-    return bishop_attack_table[s][key];
+#ifdef USE_PEXT
+    int index = _pext_u64(blockers, slider_attacks.bishop_occupancy[s]);
+#else
+    int index = bishop_magic_index(s, blockers, slider_attacks.bishop_occupancy[s]);
+#endif
+    return slider_attacks.attacks[slider_attacks.bishop_offsets[s] + index];
 }
 
 Bitboard rook_attack_bb(Square s, Bitboard blockers)
 {
-    blockers &= rook_occupancy_bitboards[s];
-    Bitboard key = (blockers * rook_magics[s]) >> rook_index_bits[s];
-    return rook_attack_table[s][key];
+#ifdef USE_PEXT
+    int index = _pext_u64(blockers, slider_attacks.rook_occupancy[s]);
+#else
+    int index = rook_magic_index(s, blockers, slider_attacks.rook_occupancy[s]);
+#endif
+    return slider_attacks.attacks[slider_attacks.rook_offsets[s] + index];
 }
 
 void print_bitboard(Bitboard b)
@@ -17,10 +17,6 @@ extern Bitboard file_bitboards[64];
 
 extern Bitboard rank_bitboards[64];
 
-extern Bitboard bishop_occupancy_bitboards[64];
-
-extern Bitboard rook_occupancy_bitboards[64];
-
 extern Bitboard white_side;
 extern Bitboard black_side;
 
@@ -80,8 +76,31 @@ inline Bitboard rank_bb(Square s)
     return rank_bitboards[s];
 }
 
-template<Direction>
-extern Bitboard shift(Bitboard b);
+//Number of king moves between two squares
+inline int square_distance(Square a, Square b)
+{
+    int rank_distance = a / 8 > b / 8 ? a / 8 - b / 8 : b / 8 - a / 8;
+    int file_distance = a % 8 > b % 8 ? a % 8 - b % 8 : b % 8 - a % 8;
+    return rank_distance > file_distance ? rank_distance : file_distance;
+}
+
+const Bitboard FILE_A_BB = 0x0101010101010101ull;
+const Bitboard FILE_H_BB = 0x8080808080808080ull;
+
+//Moves every square one step in the direction, squares that would wrap around the edge of the board are dropped.
+//Inline with constant masks, so a direction known at compile time costs a shift and an and
+template<Direction D>
+inline Bitboard shift(Bitboard b)
+{
+    return D == N  ? b << 8
+         : D == S  ? b >> 8
+         : D == W  ? (b >> 1) & ~FILE_H_BB
+         : D == E  ? (b << 1) & ~FILE_A_BB
+         : D == NW ? (b << 7) & ~FILE_H_BB
+         : D == NE ? (b << 9) & ~FILE_A_BB
+         : D == SW ? (b >> 9) & ~FILE_H_BB
+         :           (b >> 7) & ~FILE_A_BB;
+}
 
 extern void print_bitboard(Bitboard b);
 
@@ -146,4 +165,65 @@ inline Square pop_lsb(Bitboard* b) {
   return s;
 }
 
+//Mirrors the board vertically (a1 <-> a8), so a black piece is seen from white's point of view
+inline Bitboard flip_vertical(Bitboard b) {
+#if defined(_MSC_VER)
+  return _byteswap_uint64(b);
+#else
+  return __builtin_bswap64(b);
+#endif
+}
+
+//Two bitboards packed into one 128 bit register, used to evaluate both colors at once.
+//Lane 0 holds white, lane 1 holds black flipped to white's point of view, so both lanes
+//share the same directions and masks.
+#if defined(__GNUC__)
+typedef Bitboard Bitboard2 __attribute__((vector_size(16)));
+#else
+struct Bitboard2 {
+  Bitboard lanes[2];
+  Bitboard operator[](int i) const { return lanes[i]; }
+};
+inline Bitboard2 operator&(Bitboard2 a, Bitboard2 b) { return { a.lanes[0] & b.lanes[0], a.lanes[1] & b.lanes[1] }; }
+inline Bitboard2 operator|(Bitboard2 a, Bitboard2 b) { return { a.lanes[0] | b.lanes[0], a.lanes[1] | b.lanes[1] }; }
+inline Bitboard2 operator~(Bitboard2 a) { return { ~a.lanes[0], ~a.lanes[1] }; }
+inline Bitboard2 operator<<(Bitboard2 a, int n) { return { a.lanes[0] << n, a.lanes[1] << n }; }
+inline Bitboard2 operator>>(Bitboard2 a, int n) { return { a.lanes[0] >> n, a.lanes[1] >> n }; }
+#endif
+
+inline Bitboard2 make_bitboard2(Bitboard white_bb, Bitboard black_bb) {
+  Bitboard2 b = { white_bb, flip_vertical(black_bb) };
+  return b;
+}
+
+inline Bitboard2 broadcast(Bitboard b) {
+  Bitboard2 b2 = { b, b };
+  return b2;
+}
+
+inline Bitboard2 shift_east(Bitboard2 b) {
+  return (b << 1) & broadcast(~FILE_A_BB);
+}
+
+inline Bitboard2 shift_west(Bitboard2 b) {
+  return (b >> 1) & broadcast(~FILE_H_BB);
+}
+
+//Smears every set square to the end of the board (inclusive)
+inline Bitboard2 north_fill(Bitboard2 b) {
+  b = b | (b << 8);
+  b = b | (b << 16);
+  return b | (b << 32);
+}
+
+inline Bitboard2 south_fill(Bitboard2 b) {
+  b = b | (b >> 8);
+  b = b | (b >> 16);
+  return b | (b >> 32);
+}
+
+inline Bitboard2 file_fill(Bitboard2 b) {
+  return north_fill(south_fill(b));
+}
+
 #endif //!BITBOARDS_H
\ No newline at end of file
@@ -0,0 +1,209 @@
+#include "bitboards.h"
+#include "bitbase.h"
+#include "endgame.h"
+#include "material.h"
+
+namespace endgame
+{
+    Endgame endgames[ENDGAME_TABLE_SIZE];
+
+    //Bonus for driving the weak king towards the edge of the board
+    inline int push_to_edge(Square s)
+    {
+        int rank = s / 8, file = s % 8;
+        int rank_distance = rank < 4 ? 3 - rank : rank - 4;
+        int file_distance = file < 4 ? 3 - file : file - 4;
+        return 20 * (rank_distance + file_distance);
+    }
+
+    //Bonus for bringing the kings close together
+    inline int push_close(Square a, Square b)
+    {
+        return 140 - 20 * square_distance(a, b);
+    }
+
+    inline bool is_dark_square(Square s)
+    {
+        return (s / 8 + s % 8) % 2 == 0;
+    }
+
+    int non_pawn_material(Position *pos, Color c)
+    {
+        int score = 0;
+        for(int piece_type = KNIGHT; piece_type <= QUEEN; piece_type++)
+            score += pos->material[make_piece(piece_type, c)] * material::PIECE_VALUES[piece_type];
+        return score;
+    }
+
+    //A lone king which is not in check, but cannot move, is stalemated
+    bool is_lone_king_stalemated(Position *pos, Color weak_side)
+    {
+        Square weak_king = lsb(pos->piece_bitboard[make_piece(KING, weak_side)]);
+        return pos->color_to_move == weak_side
+            && !pos->current_state->in_check
+            && !(king_attack_bb(weak_king) & ~pos->current_state->attack_bitboards[~weak_side]);
+    }
+
+    //Mate with a queen or a rook: drive the weak king to the edge
+    int evaluate_kxk(Position *pos, Color strong_side)
+    {
+        if(is_lone_king_stalemated(pos, ~strong_side))
+            return 0;
+
+        Square strong_king = lsb(pos->piece_bitboard[make_piece(KING, strong_side)]);
+        Square weak_king = lsb(pos->piece_bitboard[make_piece(KING, ~strong_side)]);
+
+        return KNOWN_WIN + non_pawn_material(pos, strong_side) + push_to_edge(weak_king) + push_close(strong_king, weak_king);
+    }
+
+    //Mate with bishop and knight: drive the weak king to a corner of the bishop's color
+    int evaluate_kbnk(Position *pos, Color strong_side)
+    {
+        if(is_lone_king_stalemated(pos, ~strong_side))
+            return 0;
+
+        Square strong_king = lsb(pos->piece_bitboard[make_piece(KING, strong_side)]);
+        Square weak_king = lsb(pos->piece_bitboard[make_piece(KING, ~strong_side)]);
+        Square bishop = lsb(pos->piece_bitboard[make_piece(BISHOP, strong_side)]);
+
+        //Mirror the board for a light squared bishop, so that the mating corners are a1 and h8
+        Square corner_king = is_dark_square(bishop) ? weak_king : (Square)(weak_king ^ 7);
+        int corner_distance = manhattan_distance[corner_king][a1] < manhattan_distance[corner_king][h8] ? manhattan_distance[corner_king][a1] : manhattan_distance[corner_king][h8];
+
+        return KNOWN_WIN + non_pawn_material(pos, strong_side) + push_to_edge(weak_king) + 20 * (7 - corner_distance) + push_close(strong_king, weak_king);
+    }
+
+    //King and pawn against king is looked up in the bitbase
+    int evaluate_kpk(Position *pos, Color strong_side)
+    {
+        Square strong_king = lsb(pos->piece_bitboard[make_piece(KING, strong_side)]);
+        Square weak_king = lsb(pos->piece_bitboard[make_piece(KING, ~strong_side)]);
+        Square pawn = lsb(pos->piece_bitboard[make_piece(PAWN, strong_side)]);
+
+        //The bitbase sees the board from the side with the pawn
+        if(strong_side == black)
+        {
+            strong_king = (Square)(strong_king ^ 56);
+            weak_king = (Square)(weak_king ^ 56);
+            pawn = (Square)(pawn ^ 56);
+        }
+
+        Color us = pos->color_to_move == strong_side ? white : black;
+        if(!bitbase::probe_kpk(strong_king, pawn, weak_king, us))
+            return 0;
+
+        //Prefer advancing the pawn
+        return KNOWN_WIN + material::PIECE_VALUES[PAWN] + pawn / 8;
+    }
+
+    //Two knights cannot force mate
+    int evaluate_knnk(Position *pos, Color strong_side)
+    {
+        (void) pos;
+        (void) strong_side;
+        return 0;
+    }
+
+    //Queen against rook is usually won, but it takes a while: drive the weak king to the edge
+    int evaluate_kqkr(Position *pos, Color strong_side)
+    {
+        Square strong_king = lsb(pos->piece_bitboard[make_piece(KING, strong_side)]);
+        Square weak_king = lsb(pos->piece_bitboard[make_piece(KING, ~strong_side)]);
+
+        return material::PIECE_VALUES[QUEEN] - material::PIECE_VALUES[ROOK] + push_to_edge(weak_king) + push_close(strong_king, weak_king);
+    }
+
+    //A rook pawn with a bishop of the wrong color is a draw if the weak king reaches the queening corner
+    int scale_kbpk(Position *pos, Color strong_side)
+    {
+        Square pawn = lsb(pos->piece_bitboard[make_piece(PAWN, strong_side)]);
+        int file = pawn % 8;
+        if(file != 0 && file != 7)
+            return material::SCALE_FACTOR_NORMAL;
+
+        Square queening_square = (Square)(strong_side == white ? 56 + file : file);
+        Square bishop = lsb(pos->piece_bitboard[make_piece(BISHOP, strong_side)]);
+        Square weak_king = lsb(pos->piece_bitboard[make_piece(KING, ~strong_side)]);
+
+        if(is_dark_square(queening_square) != is_dark_square(bishop) && square_distance(queening_square, weak_king) <= 1)
+            return material::SCALE_FACTOR_DRAW;
+
+        return material::SCALE_FACTOR_NORMAL;
+    }
+
+    //Registers an endgame for both colors. The code lists the pieces of the strong side first, e.g. "KQKR"
+    void add(const char *code, EvaluationFunction evaluate, ScalingFunction scale, bool exact = false)
+    {
+        const char *piece_chars = " PNBRQK";
+
+        for(int c = white; c <= black; c++)
+        {
+            Color strong_side = (Color) c;
+            Color side = strong_side;
+
+            int material[13] = { 0 };
+            for(const char *ptr_char = code; *ptr_char; ptr_char++)
+            {
+                if(*ptr_char == 'K' && ptr_char != code)
+                    side = ~strong_side; //The pieces after the second king belong to the weak side
+
+                for(int piece_type = PAWN; piece_type <= KING; piece_type++)
+                {
+                    if(piece_chars[piece_type] == *ptr_char)
+                        material[make_piece(piece_type, side)]++;
+                }
+            }
+
+            unsigned int material_key = material::material_array_to_index(material);
+
+            int index = material_key & (ENDGAME_TABLE_SIZE - 1);
+            while(endgames[index].evaluate != nullptr || endgames[index].scale != nullptr)
+                index = (index + 1) & (ENDGAME_TABLE_SIZE - 1);
+
+            endgames[index].material_key = material_key;
+            endgames[index].strong_side = strong_side;
+            endgames[index].evaluate = evaluate;
+            endgames[index].scale = scale;
+            endgames[index].exact = exact;
+
+            //Pawns are not part of the material table index, so the entry keeps one flag per pawn count
+            ASSERT(material[WHITE_PAWN] <= 1 && material[BLACK_PAWN] <= 1);
+            material::material_table[material_key % material::PIECE_CONFIGS].endgame |= 1 << (material[WHITE_PAWN] + 2 * material[BLACK_PAWN]);
+        }
+    }
+
+    void init()
+    {
+        add("KQK", &evaluate_kxk, nullptr);
+        add("KRK", &evaluate_kxk, nullptr);
+        add("KBNK", &evaluate_kbnk, nullptr);
+        add("KPK", &evaluate_kpk, nullptr, true);
+        add("KNNK", &evaluate_knnk, nullptr);
+        add("KQKR", &evaluate_kqkr, nullptr);
+
+        add("KBPK", nullptr, &scale_kbpk);
+    }
+
+    Endgame *probe(unsigned int material_key)
+    {
+        for(int index = material_key & (ENDGAME_TABLE_SIZE - 1);
+            endgames[index].evaluate != nullptr || endgames[index].scale != nullptr;
+            index = (index + 1) & (ENDGAME_TABLE_SIZE - 1))
+        {
+            if(endgames[index].material_key == material_key)
+                return &endgames[index];
+        }
+        return nullptr;
+    }
+
+    bool is_known_draw(Position *pos)
+    {
+        if(!material::has_endgame(material::probe(pos), pos))
+            return false;
+
+        Endgame *known_endgame = probe(pos->current_state->material_key);
+        return known_endgame != nullptr
+            && known_endgame->exact
+            && known_endgame->evaluate(pos, known_endgame->strong_side) == 0;
+    }
+}
@@ -0,0 +1,41 @@
+#ifndef ENDGAME_H
+#define ENDGAME_H
+
+#include "types.h"
+#include "position.h"
+
+namespace endgame
+{
+    //Base score of endgames that are won with correct play
+    const int KNOWN_WIN = 10000;
+
+    //Must be a power of 2, a lot larger than the number of registered endgames
+    const int ENDGAME_TABLE_SIZE = 64;
+
+    //Returns the score from the point of view of the strong side
+    typedef int (*EvaluationFunction)(Position *pos, Color strong_side);
+
+    //Returns a scale factor for the score of the strong side, see material.h
+    typedef int (*ScalingFunction)(Position *pos, Color strong_side);
+
+    struct Endgame
+    {
+        unsigned int material_key;
+        Color strong_side;
+        EvaluationFunction evaluate;
+        ScalingFunction scale;
+        //The evaluation returns 0 exactly for drawn positions (e.g. it uses a bitbase)
+        bool exact;
+    };
+
+    //Register the known endgames, material::init has to be called before
+    void init();
+
+    //Returns the endgame registered for the material key, or nullptr if there is none
+    Endgame *probe(unsigned int material_key);
+
+    //Returns true if the position is a draw according to an exact endgame evaluation
+    bool is_known_draw(Position *pos);
+}
+
+#endif //!ENDGAME_H
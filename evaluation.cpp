@@ -1,85 +1,64 @@
 #include "bitboards.h"
 #include "evaluation.h"
 #include "material.h"
-
-const int PAWN_SCORES[32] = {
-      0,   0,   0,   0,
-     20,  10, -20, -30,
-     10,  10,  10,   0,
-      0,   0,  10,  30,
-     10,  10,  10,  20,
-     15,  15,  20,  30,
-     40,  40,  40,  40,
-      0,   0,   0,   0
+#include "endgame.h"
+#include "trace.h"
+
+//Piece square tables, from white's point of view (a1 first). Black pieces are flipped
+//vertically before the lookup, so no mapper table is needed.
+const int PAWN_SCORES[64] = {
+      0,   0,   0,   0,   0,   0,   0,   0,
+     20,  10, -20, -30, -30, -20,  10,  20,
+     10,  10,  10,   0,   0,  10,  10,  10,
+      0,   0,  10,  30,  30,  10,   0,   0,
+     10,  10,  10,  20,  20,  10,  10,  10,
+     15,  15,  20,  30,  30,  20,  15,  15,
+     40,  40,  40,  40,  40,  40,  40,  40,
+      0,   0,   0,   0,   0,   0,   0,   0,
 };
 
-const int KNIGHT_SCORES[32] = {
-    -40, -20, -10, -10,
-    -20,  -5,   0,   0,
-    -10,   0,  10,  10,
-    -10,   0,  10,  20,
-    -10,   0,  10,  20,
-    -10,   0,  10,  10,
-    -20,  -5,   0,   0,
-    -40, -20, -10, -10,    
+const int KNIGHT_SCORES[64] = {
+    -40, -20, -10, -10, -10, -10, -20, -40,
+    -20,  -5,   0,   0,   0,   0,  -5, -20,
+    -10,   0,  10,  10,  10,  10,   0, -10,
+    -10,   0,  10,  20,  20,  10,   0, -10,
+    -10,   0,  10,  20,  20,  10,   0, -10,
+    -10,   0,  10,  10,  10,  10,   0, -10,
+    -20,  -5,   0,   0,   0,   0,  -5, -20,
+    -40, -20, -10, -10, -10, -10, -20, -40,
 };
 
-const int BISHOP_SCORES[32] = {
-    -30, -20, -10,   0,
-    -20, -10,   0,  10,
-    -10,   0,  10,  20,
-      0,  10,  20,  30,
-      0,  10,  20,  30,
-    -10,   0,  10,  20,
-    -20, -10,   0,  10,
-    -30, -20, -10,   0,  
+const int BISHOP_SCORES[64] = {
+    -30, -20, -10,   0,   0, -10, -20, -30,
+    -20, -10,   0,  10,  10,   0, -10, -20,
+    -10,   0,  10,  20,  20,  10,   0, -10,
+      0,  10,  20,  30,  30,  20,  10,   0,
+      0,  10,  20,  30,  30,  20,  10,   0,
+    -10,   0,  10,  20,  20,  10,   0, -10,
+    -20, -10,   0,  10,  10,   0, -10, -20,
+    -30, -20, -10,   0,   0, -10, -20, -30,
 };
 
-
-const int ROOK_SCORES[32] = {
-    -10,   0,  10,  20,
-    -10,   0,  10,  20,
-      0,   0,   0,  20,
-      0,   0,   0,  20,
-      0,   0,   0,  20,
-      0,   0,   0,  20,
-     25,  25,  25,  25,
-      0,   0,   0,  20,
+const int ROOK_SCORES[64] = {
+    -10,   0,  10,  20,  20,  10,   0, -10,
+    -10,   0,  10,  20,  20,  10,   0, -10,
+      0,   0,   0,  20,  20,   0,   0,   0,
+      0,   0,   0,  20,  20,   0,   0,   0,
+      0,   0,   0,  20,  20,   0,   0,   0,
+      0,   0,   0,  20,  20,   0,   0,   0,
+     25,  25,  25,  25,  25,  25,  25,  25,
+      0,   0,   0,  20,  20,   0,   0,   0,
 };
 
-const int KING_SCORES[32] = {
-     10,  30,   0, -30,
-      5,  10, -10, -50,
-    -40, -40, -40, -40,
-    -40, -40, -40, -40,
-    -40, -40, -40, -40,
-    -40, -40, -40, -40,
-    -40, -40, -40, -40,
-    -40, -40, -40, -40,
-};
-
-const int WHITE_MAPPER[64] = 
-{
-     0,  1,  2,  3,  3,  2,  1,  0,
-     4,  5,  6,  7,  7,  6,  5,  4,
-     8,  9, 10, 11, 11, 10,  9,  8,
-    12, 13, 14, 15, 15, 14, 13, 12,
-    16, 17, 18, 19, 19, 18, 17, 16,
-    20, 21, 22, 23, 23, 22, 21, 20,
-    24, 25, 26, 27, 27, 26, 25, 24,
-    28, 29, 30, 31, 31, 30, 29, 28,
-};
-
-const int BLACK_MAPPER[64] = 
-{
-    28, 29, 30, 31, 31, 30, 29, 28,
-    24, 25, 26, 27, 27, 26, 25, 24,
-    20, 21, 22, 23, 23, 22, 21, 20,
-    16, 17, 18, 19, 19, 18, 17, 16,
-    12, 13, 14, 15, 15, 14, 13, 12,
-     8,  9, 10, 11, 11, 10,  9,  8,
-     4,  5,  6,  7,  7,  6,  5,  4,
-     0,  1,  2,  3,  3,  2,  1,  0,
+const int KING_SCORES[64] = {
+     10,  30,   0, -30, -30,   0,  30,  10,
+      5,  10, -10, -50, -50, -10,  10,   5,
+    -40, -40, -40, -40, -40, -40, -40, -40,
+    -40, -40, -40, -40, -40, -40, -40, -40,
+    -40, -40, -40, -40, -40, -40, -40, -40,
+    -40, -40, -40, -40, -40, -40, -40, -40,
+    -40, -40, -40, -40, -40, -40, -40, -40,
+    -40, -40, -40, -40, -40, -40, -40, -40,
 };
 
 const int QUEEN_DISTANCE_MULTIPLIER = 5;
@@ -103,177 +82,141 @@ const int KING_HALF_OPEN_FILE_BONUS = -21; //only if on flank
 //[is_open us][is_open them]
 const int ROOK_OPEN_FILE_BONUS[2][2] = {{ 80, 50 }, { 20, -20 }};
 
-int evaluate(Position *pos)
+//Piece square and king distance scores of the pieces in one lane
+inline void add_piece_scores(Bitboard pieces, const int scores[64], Square enemy_king_square, int distance_multiplier, int *score, int *king_distance)
 {
-    int score = pos->current_state->is_standard_material_config ? material::material_scores[pos->current_state->material_key] : material::evaluate_material_config(pos->material);
-
-    Bitboard outposts_white = (pos->piece_bitboard[WHITE_KNIGHT] | pos->piece_bitboard[WHITE_BISHOP]) //outposts are bishops and knights
-                            &  pos->current_state->pawn_attack_bitboards[white] //that are on a square controlled by our pawns
-                            & ~pos->current_state->pawn_attack_bitboards[black] //that is not attacked by an opponent pawn
-                            &  black_side; //that is on the opponents sied of the board
-    Bitboard outposts_black = (pos->piece_bitboard[BLACK_KNIGHT] | pos->piece_bitboard[BLACK_BISHOP]) //outposts are bishops and knights
-                            &  pos->current_state->pawn_attack_bitboards[black] //that are on a square controlled by our pawns
-                            & ~pos->current_state->pawn_attack_bitboards[white] //that is not attacked by an opponent pawn
-                            &  white_side; //that is on the opponents sied of the board
-    score += OUTPOST_BONUS * popcount(outposts_white);
-    score -= OUTPOST_BONUS * popcount(outposts_black);
-
-    Square white_king_square = lsb(pos->piece_bitboard[WHITE_KING]);
-    Square black_king_square = lsb(pos->piece_bitboard[BLACK_KING]);
-    score += KING_SCORES[WHITE_MAPPER[white_king_square]];
-    score -= KING_SCORES[BLACK_MAPPER[black_king_square]];
-
-    int king_distance = 0;
-
-    Bitboard white_rooks = pos->piece_bitboard[WHITE_ROOK];
-    Bitboard black_rooks = pos->piece_bitboard[BLACK_ROOK];
-    while(white_rooks)
-    {
-        Square rook_square = pop_lsb(&white_rooks);
-        bool is_open_white = pos->piece_bitboard[WHITE_PAWN] & file_bitboards[rook_square];
-        bool is_open_black = pos->piece_bitboard[BLACK_PAWN] & file_bitboards[rook_square];
-        score += ROOK_OPEN_FILE_BONUS[is_open_white][is_open_black];
-        score += ROOK_SCORES[WHITE_MAPPER[rook_square]];
-        king_distance += (14 - manhattan_distance[rook_square][black_king_square]) * ROOK_DISTANCE_MULTIPLIER;
-    }
-    while(black_rooks)
-    {
-        Square rook_square = pop_lsb(&black_rooks);
-        bool is_open_white = pos->piece_bitboard[WHITE_PAWN] & file_bitboards[rook_square];
-        bool is_open_black = pos->piece_bitboard[BLACK_PAWN] & file_bitboards[rook_square];
-        score -= ROOK_OPEN_FILE_BONUS[is_open_black][is_open_white];
-        score -= ROOK_SCORES[BLACK_MAPPER[rook_square]];
-        king_distance -= (14 - manhattan_distance[rook_square][white_king_square]) * ROOK_DISTANCE_MULTIPLIER;
-    }
-
-    Bitboard white_knights = pos->piece_bitboard[WHITE_KNIGHT];
-    Bitboard black_knights = pos->piece_bitboard[BLACK_KNIGHT];
-    while(white_knights)
-    {
-        Square knight_square = pop_lsb(&white_knights);
-        score += KNIGHT_SCORES[WHITE_MAPPER[knight_square]];
-        king_distance += (14 - manhattan_distance[knight_square][black_king_square]) * KNIGHT_DISTANCE_MULTIPLIER;
-    }
-    while(black_knights)
-    {
-        Square knight_square = pop_lsb(&black_knights);
-        score -= KNIGHT_SCORES[BLACK_MAPPER[knight_square]];
-        king_distance -= (14 - manhattan_distance[knight_square][white_king_square]) * KNIGHT_DISTANCE_MULTIPLIER;
-    }
-
-    Bitboard white_bishops = pos->piece_bitboard[WHITE_BISHOP];
-    Bitboard black_bishops = pos->piece_bitboard[BLACK_BISHOP];
-    while(white_bishops)
-    {
-        Square bishop_square = pop_lsb(&white_bishops);
-        score += BISHOP_SCORES[WHITE_MAPPER[bishop_square]];
-        king_distance += (14 - manhattan_distance[bishop_square][black_king_square]) * BISHOP_DISTANCE_MULTIPLIER;
-    }
-    while(black_bishops)
-    {
-        Square bishop_square = pop_lsb(&black_bishops);
-        score -= BISHOP_SCORES[BLACK_MAPPER[bishop_square]];
-        king_distance -= (14 - manhattan_distance[bishop_square][white_king_square]) * BISHOP_DISTANCE_MULTIPLIER;
-    }
-
-    Bitboard white_queens = pos->piece_bitboard[WHITE_QUEEN];
-    Bitboard black_queens = pos->piece_bitboard[BLACK_QUEEN];
-    while(white_queens)
-    {
-        Square queen_square = pop_lsb(&white_queens);
-        king_distance += (14 - manhattan_distance[queen_square][black_king_square]) * QUEEN_DISTANCE_MULTIPLIER;
-    }
-    while(black_queens)
+    while(pieces)
     {
-        Square queen_square = pop_lsb(&black_queens);
-        king_distance -= (14 - manhattan_distance[queen_square][white_king_square]) * QUEEN_DISTANCE_MULTIPLIER;
+        Square square = pop_lsb(&pieces);
+        *score += scores[square];
+        *king_distance += (14 - manhattan_distance[square][enemy_king_square]) * distance_multiplier;
     }
+}
 
-    Bitboard white_pawns = pos->piece_bitboard[WHITE_PAWN];
-    Bitboard black_pawns = pos->piece_bitboard[BLACK_PAWN];
-
-    if(pos->piece_bitboard[WHITE_KING] & center_files)
-    {
-        score += KING_IN_CENTER_BONUS;
-    }
-    else if(pos->piece_bitboard[WHITE_KING] & queenside_flank)
-    {
-        score += KING_PAWNSHIELD_BONUS * popcount(white_pawns & white_queenside_pawnshield);
-        for(int i = 0; i <= 2; i++)
+int evaluate(Position *pos)
+{
+    TRACE_SCOPE(trace::EVALUATE);
+    material::Entry *material_entry = material::probe(pos);
+
+    //Known endgames have their own evaluation
+    endgame::Endgame *known_endgame = material::has_endgame(material_entry, pos) ? endgame::probe(pos->current_state->material_key) : nullptr;
+    if(known_endgame != nullptr && known_endgame->evaluate != nullptr)
+    {
+        int endgame_score = known_endgame->evaluate(pos, known_endgame->strong_side);
+        return pos->color_to_move == known_endgame->strong_side ? endgame_score : -endgame_score;
+    }
+
+    int score = material_entry->score + material::PIECE_VALUES[WHITE_PAWN] * (pos->material[WHITE_PAWN] - pos->material[BLACK_PAWN]);
+
+    //Both colors are evaluated at once: lane 0 is white, lane 1 is black seen from white's side
+    Bitboard2 pawns      = make_bitboard2(pos->piece_bitboard[WHITE_PAWN], pos->piece_bitboard[BLACK_PAWN]);
+    Bitboard2 them_pawns = make_bitboard2(pos->piece_bitboard[BLACK_PAWN], pos->piece_bitboard[WHITE_PAWN]);
+    Bitboard2 pawn_attacks      = make_bitboard2(pos->current_state->pawn_attack_bitboards[white], pos->current_state->pawn_attack_bitboards[black]);
+    Bitboard2 them_pawn_attacks = make_bitboard2(pos->current_state->pawn_attack_bitboards[black], pos->current_state->pawn_attack_bitboards[white]);
+    Bitboard2 kings = make_bitboard2(pos->piece_bitboard[WHITE_KING], pos->piece_bitboard[BLACK_KING]);
+    Bitboard2 rooks = make_bitboard2(pos->piece_bitboard[WHITE_ROOK], pos->piece_bitboard[BLACK_ROOK]);
+    Bitboard2 knights = make_bitboard2(pos->piece_bitboard[WHITE_KNIGHT], pos->piece_bitboard[BLACK_KNIGHT]);
+    Bitboard2 bishops = make_bitboard2(pos->piece_bitboard[WHITE_BISHOP], pos->piece_bitboard[BLACK_BISHOP]);
+    Bitboard2 queens = make_bitboard2(pos->piece_bitboard[WHITE_QUEEN], pos->piece_bitboard[BLACK_QUEEN]);
+
+    //The squares of the files with at least one pawn
+    Bitboard2 pawn_files = file_fill(pawns);
+    Bitboard2 them_pawn_files = file_fill(them_pawns);
+
+    int lane_score[2] = { 0, 0 };
+    int king_distance[2] = { 0, 0 };
+
+    Bitboard2 outposts = (knights | bishops) //outposts are bishops and knights
+                       & pawn_attacks //that are on a square controlled by our pawns
+                       & ~them_pawn_attacks //that is not attacked by an opponent pawn
+                       & broadcast(black_side); //that is on the opponents side of the board
+
+    //Pawn structure
+    Bitboard2 isolated = pawns & (shift_east(pawn_files) | shift_west(pawn_files));
+    Bitboard2 doubled = pawns & south_fill(pawns >> 8); //Another pawn of ours is in front
+    Bitboard2 them_front_span = south_fill(them_pawns >> 8);
+    Bitboard2 passed = pawns & ~(them_front_span | shift_east(them_front_span) | shift_west(them_front_span));
+
+    //King safety
+    Bitboard2 king_in_center = kings & broadcast(center_files);
+    Bitboard2 king_on_queenside = kings & broadcast(queenside_flank);
+    //The flank masks are the same for both colors, only the side of the king differs
+    Bitboard2 pawnshield_mask = { king_on_queenside[0] ? white_queenside_pawnshield : white_kingside_pawnshield,
+                                  king_on_queenside[1] ? white_queenside_pawnshield : white_kingside_pawnshield };
+    Bitboard2 flank_mask = { king_on_queenside[0] ? queenside_flank : kingside_flank,
+                             king_on_queenside[1] ? queenside_flank : kingside_flank };
+    Bitboard2 pawnshield = pawns & pawnshield_mask;
+    Bitboard2 half_open_flank_files = ~pawn_files & broadcast(rank_bitboards[a1]) & flank_mask;
+
+    Square king_square[2] = { lsb(kings[0]), lsb(kings[1]) };
+
+    for(int lane = 0; lane < 2; lane++)
+    {
+        //The enemy king, seen from the point of view of this lane
+        Square enemy_king_square = (Square)(king_square[1 - lane] ^ 56);
+        int *s = &lane_score[lane];
+
+        *s += OUTPOST_BONUS * popcount(outposts[lane]);
+        *s += KING_SCORES[king_square[lane]];
+
+        if(king_in_center[lane])
         {
-            if(!(white_pawns & file_bitboards[i]))
-                score += KING_HALF_OPEN_FILE_BONUS;
+            *s += KING_IN_CENTER_BONUS;
         }
-    }
-    else //if(pos->piece_bitboard[WHITE_KING] & kingside_flank)
-    {
-        score += KING_PAWNSHIELD_BONUS * popcount(white_pawns & white_kingside_pawnshield);
-        for(int i = 5; i <= 7; i++)
+        else
         {
-            if(!(white_pawns & file_bitboards[i]))
-                score += KING_HALF_OPEN_FILE_BONUS;
+            *s += KING_PAWNSHIELD_BONUS * popcount(pawnshield[lane]);
+            *s += KING_HALF_OPEN_FILE_BONUS * popcount(half_open_flank_files[lane]);
         }
-    }
 
-    if(pos->piece_bitboard[BLACK_KING] & center_files)
-    {
-        score -= KING_IN_CENTER_BONUS;
-    }
-    else if(pos->piece_bitboard[BLACK_KING] & queenside_flank)
-    {
-        score -= KING_PAWNSHIELD_BONUS * popcount(black_pawns & black_queenside_pawnshield);
-        for(int i = 0; i <= 2; i++)
-        {
-            if(!(black_pawns & file_bitboards[i]))
-                score -= KING_HALF_OPEN_FILE_BONUS;
-        }
-    }
-    else //if(pos->piece_bitboard[BLACK_KING] & kingside_flank)
-    {
-        score -= KING_PAWNSHIELD_BONUS * popcount(black_pawns & black_kingside_pawnshield);
-        for(int i = 5; i <= 7; i++)
+        *s += ISOLATED_PAWN_BONUS * popcount(isolated[lane]);
+        *s += DOUBLED_PAWN_BONUS * popcount(doubled[lane]);
+
+        Bitboard passed_pawns = passed[lane];
+        while(passed_pawns)
+            *s += PASSED_PAWN_BONUS[pop_lsb(&passed_pawns) / 8];
+
+        Bitboard lane_pawns = pawns[lane];
+        while(lane_pawns)
+            *s += PAWN_SCORES[pop_lsb(&lane_pawns)];
+
+        Bitboard lane_rooks = rooks[lane];
+        while(lane_rooks)
         {
-            if(!(black_pawns & file_bitboards[i]))
-                score -= KING_HALF_OPEN_FILE_BONUS;
+            Square rook_square = pop_lsb(&lane_rooks);
+            bool is_open_us = get_square(pawn_files[lane], rook_square);
+            bool is_open_them = get_square(them_pawn_files[lane], rook_square);
+            *s += ROOK_OPEN_FILE_BONUS[is_open_us][is_open_them];
+            *s += ROOK_SCORES[rook_square];
+            king_distance[lane] += (14 - manhattan_distance[rook_square][enemy_king_square]) * ROOK_DISTANCE_MULTIPLIER;
         }
-    }
 
-    while(white_pawns)
-    {
-        Square pawn_square = pop_lsb(&white_pawns);
-        int rank = pawn_square / 8;
-
-        if(isolated_pawn_bitboards[pawn_square] & pos->piece_bitboard[WHITE_PAWN])
-            score += ISOLATED_PAWN_BONUS;
-        if(doubled_pawn_bitboards[white][pawn_square] & pos->piece_bitboard[WHITE_PAWN])
-            score += DOUBLED_PAWN_BONUS;
-        if(!(passed_pawn_bitboards[white][pawn_square] & pos->piece_bitboard[BLACK_PAWN]))
-            score += PASSED_PAWN_BONUS[rank];
-        score += PAWN_SCORES[WHITE_MAPPER[pawn_square]];
-    }
-    while(black_pawns)
-    {
-        Square pawn_square = pop_lsb(&black_pawns);
-        int rank = pawn_square / 8;
-
-        if(isolated_pawn_bitboards[pawn_square] & pos->piece_bitboard[BLACK_PAWN])
-            score -= ISOLATED_PAWN_BONUS;
-        if(doubled_pawn_bitboards[black][pawn_square] & pos->piece_bitboard[BLACK_PAWN])
-            score -= DOUBLED_PAWN_BONUS;
-        if(!(passed_pawn_bitboards[black][pawn_square] & pos->piece_bitboard[WHITE_PAWN]))
-            score -= PASSED_PAWN_BONUS[7 - rank];
-        score -= PAWN_SCORES[BLACK_MAPPER[pawn_square]];
+        add_piece_scores(knights[lane], KNIGHT_SCORES, enemy_king_square, KNIGHT_DISTANCE_MULTIPLIER, s, &king_distance[lane]);
+        add_piece_scores(bishops[lane], BISHOP_SCORES, enemy_king_square, BISHOP_DISTANCE_MULTIPLIER, s, &king_distance[lane]);
+
+        Bitboard lane_queens = queens[lane];
+        while(lane_queens)
+            king_distance[lane] += (14 - manhattan_distance[pop_lsb(&lane_queens)][enemy_king_square]) * QUEEN_DISTANCE_MULTIPLIER;
     }
 
+    score += lane_score[white] - lane_score[black];
 
     //Space scores: Space is the amount of squares attacked, which are also in the enemies terretory
     int space_white = popcount(pos->current_state->attack_bitboards[white] | pos->color_bitboard[white]);
     int space_black = popcount(pos->current_state->attack_bitboards[black] | pos->color_bitboard[black]);
 
     score += (space_white - space_black) * SPACE_BONUS;
-    score += king_distance * DISTANCE_BONUS;
+    score += (king_distance[white] - king_distance[black]) * DISTANCE_BONUS;
+
+    //Scale down the score if the side that is ahead has no pawns and not enough material to win
+    Color strong_side = score > 0 ? white : black;
+    int scale_factor = pos->material[make_piece(PAWN, strong_side)] ? (int) material::SCALE_FACTOR_NORMAL : material_entry->scale_factor[strong_side];
+    if(known_endgame != nullptr && known_endgame->scale != nullptr && known_endgame->strong_side == strong_side)
+        scale_factor = known_endgame->scale(pos, strong_side);
+    if(scale_factor != material::SCALE_FACTOR_NORMAL)
+        score = score * scale_factor / material::SCALE_FACTOR_NORMAL;
 
     int preference = pos->color_to_move == white ? 1 : -1;
 
     return preference * score;
-}
\ No newline at end of file
+}
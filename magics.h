@@ -3,7 +3,7 @@
 
 #include "types.h" //For Bitboard
 
-const Bitboard rook_magics[64] = {
+constexpr Bitboard rook_magics[64] = {
     0xa8002c000108020ULL, 0x6c00049b0002001ULL, 0x100200010090040ULL, 0x2480041000800801ULL, 0x280028004000800ULL,
     0x900410008040022ULL, 0x280020001001080ULL, 0x2880002041000080ULL, 0xa000800080400034ULL, 0x4808020004000ULL,
     0x2290802004801000ULL, 0x411000d00100020ULL, 0x402800800040080ULL, 0xb000401004208ULL, 0x2409000100040200ULL,
@@ -19,7 +19,7 @@ const Bitboard rook_magics[64] = {
     0x489a000810200402ULL, 0x1004400080a13ULL, 0x4000011008020084ULL, 0x26002114058042ULL
 };
 
-const Bitboard bishop_magics[64] = {
+constexpr Bitboard bishop_magics[64] = {
     0x89a1121896040240ULL, 0x2004844802002010ULL, 0x2068080051921000ULL, 0x62880a0220200808ULL, 0x4042004000000ULL,
     0x100822020200011ULL, 0xc00444222012000aULL, 0x28808801216001ULL, 0x400492088408100ULL, 0x201c401040c0084ULL,
     0x840800910a0010ULL, 0x82080240060ULL, 0x2000840504006000ULL, 0x30010c4108405004ULL, 0x1008005410080802ULL,
@@ -35,7 +35,7 @@ const Bitboard bishop_magics[64] = {
     0x1000042304105ULL, 0x10008830412a00ULL, 0x2520081090008908ULL, 0x40102000a0a60140ULL,
 };
 
-const int rook_index_bits[64] = {
+constexpr int rook_index_bits[64] = {
     64-12, 64-11, 64-11, 64-11, 64-11, 64-11, 64-11, 64-12,
     64-11, 64-10, 64-10, 64-10, 64-10, 64-10, 64-10, 64-11,
     64-11, 64-10, 64-10, 64-10, 64-10, 64-10, 64-10, 64-11,
@@ -46,7 +46,7 @@ const int rook_index_bits[64] = {
     64-12, 64-11, 64-11, 64-11, 64-11, 64-11, 64-11, 64-12
 };
 
-const int bishop_index_bits[64] = {
+constexpr int bishop_index_bits[64] = {
     64-6, 64-5, 64-5, 64-5, 64-5, 64-5, 64-5, 64-6,
     64-5, 64-5, 64-5, 64-5, 64-5, 64-5, 64-5, 64-5,
     64-5, 64-5, 64-7, 64-7, 64-7, 64-7, 64-5, 64-5,
@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include <string.h>
 
 #include "bitboards.h"
 #include "movegen.h"
@@ -8,6 +9,10 @@
 #include "zobrist.h"
 #include "tt.h"
 #include "material.h"
+#include "endgame.h"
+#include "bitbase.h"
+#include "syzygy.h"
+#include "bench.h"
 
 const char *SQUARE_NAMES[64] = {
     "a1", "b1", "c1", "d1", "e1", "f1", "g1", "h1",
@@ -60,12 +65,38 @@ int count_positions(int startdepth, int depth, Position *pos)
 }
 
 
-int main()
+int main(int argc, char **argv)
 {
     init_bitboards();
 
     zobrist::init();
     material::init();
+    endgame::init();
+#ifdef DEBUG
+    //Generate the KPK bitbase eagerly, so that its verification runs on every debug start
+    bitbase::init();
+#endif
+    init_search();
+
+    //main bench [hash] [threads] [depth]
+    if(argc > 1 && !strcmp(argv[1], "bench"))
+    {
+        char args[256] = "";
+        for(int i = 2; i < argc && i < 5; i++)
+        {
+            strncat(args, argv[i], 32);
+            strcat(args, " ");
+        }
+        bench::run(args);
+        return 0;
+    }
+
+    //main tbcheck <SyzygyPath>, fails if a probe does not give the known result
+    if(argc > 2 && !strcmp(argv[1], "tbcheck"))
+    {
+        syzygy::init(argv[2]);
+        return syzygy::check() ? 1 : 0;
+    }
 
     uci::init();
     uci::loop();
@@ -3,7 +3,15 @@
 
 namespace material{
     int material_key_offsets[13];
-    int material_scores[9 * 9 * 3 * 3 * 3 * 3 * 3 * 3 * 2 * 2];
+    Entry material_table[PIECE_CONFIGS];
+
+    struct HashEntry
+    {
+        Key key;
+        Entry entry;
+    };
+
+    HashEntry material_hash[MATERIAL_HASH_SIZE];
 
     const int PIECE_VALUES[13] = { 0, 100, 325, 325, 550, 1100, 0, -100, -325, -325, -550, -1100, 0 };
     const int BISHOP_PAIR_BONUS = 30;
@@ -20,10 +28,8 @@ namespace material{
         material_key_offsets[BLACK_KNIGHT] = 2 * 2 * 3 * 3 * 3 * 3 * 3;
         material_key_offsets[WHITE_PAWN]   = 2 * 2 * 3 * 3 * 3 * 3 * 3 * 3;
         material_key_offsets[BLACK_PAWN]   = 2 * 2 * 3 * 3 * 3 * 3 * 3 * 3 * 8;
-        
-        //Precompute all standard material configuration scores
-        for(int wp = 0; wp <= 8; wp++)
-        for(int bp = 0; bp <= 8; bp++)
+
+        //Precompute all standard piece configurations
         for(int wn = 0; wn <= 2; wn++)
         for(int bn = 0; bn <= 2; bn++)
         for(int wb = 0; wb <= 2; wb++)
@@ -35,8 +41,8 @@ namespace material{
         {
             int material[13];
             material[NO_PIECE] = 0;
-            material[WHITE_PAWN] = wp;
-            material[BLACK_PAWN] = bp;
+            material[WHITE_PAWN] = 0;
+            material[BLACK_PAWN] = 0;
             material[WHITE_KNIGHT] = wn;
             material[BLACK_KNIGHT] = bn;
             material[WHITE_BISHOP] = wb;
@@ -49,13 +55,13 @@ namespace material{
             material[BLACK_KING] = 1;
 
             int material_key = material_array_to_index(material);
-            material_scores[material_key] = material::evaluate_material_config(material);
+            evaluate_material_config(material, &material_table[material_key]);
         }
     }
 
     int material_array_to_index(int material[])
     {
-        return 
+        return
           material_key_offsets[WHITE_QUEEN]  * material[WHITE_QUEEN]
         + material_key_offsets[BLACK_QUEEN]  * material[BLACK_QUEEN]
         + material_key_offsets[WHITE_ROOK]   * material[WHITE_ROOK]
@@ -78,12 +84,15 @@ namespace material{
         *key -= material_key_offsets[piece];
     }
 
-    int evaluate_material_config(int material[])
+    void evaluate_material_config(int material[], Entry *entry)
     {
         int score = 0;
-        for(int i = 0; i < 13; i++)
+        int non_pawn_material[2] = { 0, 0 };
+        for(int i = WHITE_KNIGHT; i <= BLACK_QUEEN; i++)
         {
+            if(i == WHITE_KING || i == BLACK_PAWN) continue;
             score += material[i] * PIECE_VALUES[i];
+            non_pawn_material[color_of(i)] += material[i] * PIECE_VALUES[make_piece(piece_type_of(i), white)];
         }
 
         //Bishop pair scores
@@ -92,6 +101,33 @@ namespace material{
         if(material[BLACK_BISHOP] >= 2)
             score -= BISHOP_PAIR_BONUS;
 
-        return score;
+        entry->score = score;
+        entry->endgame = 0;
+
+        //Without pawns, a small material advantage is usually not enough to win
+        for(int c = white; c <= black; c++)
+        {
+            int us = non_pawn_material[c];
+            int them = non_pawn_material[1 - c];
+            entry->scale_factor[c] = SCALE_FACTOR_NORMAL;
+            if(us - them <= PIECE_VALUES[WHITE_BISHOP])
+                entry->scale_factor[c] = us < PIECE_VALUES[WHITE_ROOK] ? SCALE_FACTOR_DRAW : them <= PIECE_VALUES[WHITE_BISHOP] ? 4 : 14;
+        }
+    }
+
+    Entry *probe_hash(int material[])
+    {
+        //Every piece count fits into 4 bits, so the packed counts are a unique key
+        Key key = 0;
+        for(int i = WHITE_KNIGHT; i <= BLACK_QUEEN; i++)
+            key |= (Key) material[i] << (4 * i);
+
+        HashEntry *hash_entry = &material_hash[(key * 0x9E3779B97F4A7C15ull) >> (64 - MATERIAL_HASH_BITS)];
+        if(hash_entry->key != key)
+        {
+            hash_entry->key = key;
+            evaluate_material_config(material, &hash_entry->entry);
+        }
+        return &hash_entry->entry;
     }
-}
\ No newline at end of file
+}
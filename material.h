@@ -1,23 +1,65 @@
 #ifndef MATERIAL_H
 #define MATERIAL_H
 
+#include <stdint.h>
+
 #include "types.h"
+#include "position.h"
 
 namespace material
 {
-    extern int material_scores[9 * 9 * 3 * 3 * 3 * 3 * 3 * 3 * 2 * 2];
+    //Number of standard piece configurations (up to 2 knights, 2 bishops, 2 rooks, 1 queen per side), pawns excluded
+    const int PIECE_CONFIGS = 3 * 3 * 3 * 3 * 3 * 3 * 2 * 2;
+    //Size of the cache for non-standard configurations
+    const int MATERIAL_HASH_BITS = 10;
+    const int MATERIAL_HASH_SIZE = 1 << MATERIAL_HASH_BITS;
+
+    const int SCALE_FACTOR_DRAW = 0;
+    const int SCALE_FACTOR_NORMAL = 64;
+
+    //Material data of a piece configuration. Pawns are not part of it, their value is added on top
+    struct Entry
+    {
+        int16_t score;
+        //[Color] The scale factor to apply if that color is ahead but has no pawns left
+        uint8_t scale_factor[2];
+        //Bit (white pawns + 2 * black pawns) is set if a specialized endgame is registered for this
+        //piece configuration with that many pawns (see endgame.h). Endgames have at most one pawn per side
+        uint8_t endgame;
+    };
+
+    //Returns true if a specialized endgame is registered for the full material of the position, pawns included
+    inline bool has_endgame(Entry *entry, Position *pos)
+    {
+        unsigned int white_pawns = pos->material[WHITE_PAWN];
+        unsigned int black_pawns = pos->material[BLACK_PAWN];
+        return (white_pawns | black_pawns) <= 1 && ((entry->endgame >> (white_pawns + 2 * black_pawns)) & 1);
+    }
+
+    extern Entry material_table[PIECE_CONFIGS];
     extern const int PIECE_VALUES[13];
-    //Init default material constellations (up to 8 pawns, 2 knights, 2 bishops, 2 rooks, 1 queen per side)
+    //Init default material constellations (2 knights, 2 bishops, 2 rooks, 1 queen per side)
     void init();
 
     //Returns the index corresponding to the material array.
     int material_array_to_index(int material[]);
 
     void material_key_add_piece(unsigned int *key, Piece piece);
-    
+
     void material_key_remove_piece(unsigned int *key, Piece piece);
 
-    int evaluate_material_config(int material[]);
+    void evaluate_material_config(int material[], Entry *entry);
+
+    //Looks up (or computes and caches) the entry of a non-standard material configuration
+    Entry *probe_hash(int material[]);
+
+    inline Entry *probe(Position *pos)
+    {
+        //The pawn counts are the most significant digits of the material key
+        if(pos->current_state->is_standard_material_config)
+            return &material_table[pos->current_state->material_key % PIECE_CONFIGS];
+        return probe_hash(pos->material);
+    }
 }
 
-#endif
\ No newline at end of file
+#endif
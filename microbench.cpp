@@ -0,0 +1,275 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "bitboards.h"
+#include "zobrist.h"
+#include "material.h"
+#include "endgame.h"
+#include "bitbase.h"
+#include "position.h"
+#include "movegen.h"
+#include "movepick.h"
+#include "evaluation.h"
+#include "search.h"
+#include "tt.h"
+#include "bench.h"
+
+//Times the building blocks of the search over the bench positions and prints the results as JSON:
+//microbench [rounds]
+
+//Every result goes into the sink, so that the compiler cannot drop the measured work
+volatile unsigned long long sink;
+
+inline unsigned long long cycles()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+struct Timer
+{
+    std::chrono::steady_clock::time_point start_time;
+    unsigned long long start_cycles;
+
+    Timer()
+    {
+        start_time = std::chrono::steady_clock::now();
+        start_cycles = cycles();
+    }
+
+    double ns() { return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start_time).count(); }
+    unsigned long long elapsed_cycles() { return cycles() - start_cycles; }
+};
+
+struct Result
+{
+    const char *name;
+    long int ops;
+    double ns;
+    unsigned long long cycles;
+};
+
+std::vector<Result> results;
+
+void report(const char *name, long int ops, Timer &timer)
+{
+    //Read the cycles first, the clock call is the slower one
+    unsigned long long elapsed_cycles = timer.elapsed_cycles();
+    results.push_back({ name, ops, timer.ns(), elapsed_cycles });
+}
+
+std::vector<Position *> positions;
+
+//The legal moves of every position, generated once
+std::vector<std::vector<Move>> legal_moves;
+
+void bench_generate_moves(int rounds, bool only_captures)
+{
+    long int ops = 0;
+    unsigned long long sum = 0;
+    Timer timer;
+    for(int round = 0; round < rounds; round++)
+        for(Position *pos : positions)
+        {
+            MoveList moves(pos, only_captures);
+            sum += moves.size;
+            ops++;
+        }
+    sink = sum;
+    report(only_captures ? "generate_moves_captures" : "generate_moves_all", ops, timer);
+}
+
+void bench_do_undo_move(int rounds)
+{
+    long int ops = 0;
+    unsigned long long sum = 0;
+    Timer timer;
+    for(int round = 0; round < rounds; round++)
+        for(size_t i = 0; i < positions.size(); i++)
+            for(Move move : legal_moves[i])
+            {
+                positions[i]->do_move(move);
+                sum += positions[i]->current_state->position_key;
+                positions[i]->undo_move();
+                ops++;
+            }
+    sink = sum;
+    report("do_move_undo_move", ops, timer);
+}
+
+void bench_compute_bitboards(int rounds)
+{
+    long int ops = 0;
+    unsigned long long sum = 0;
+    Timer timer;
+    for(int round = 0; round < rounds; round++)
+        for(Position *pos : positions)
+        {
+            pos->compute_bitboards();
+            sum += pos->current_state->attack_bitboards[white];
+            ops++;
+        }
+    sink = sum;
+    report("compute_bitboards", ops, timer);
+}
+
+void bench_evaluate(int rounds)
+{
+    long int ops = 0;
+    unsigned long long sum = 0;
+    Timer timer;
+    for(int round = 0; round < rounds; round++)
+        for(Position *pos : positions)
+        {
+            sum += evaluate(pos);
+            ops++;
+        }
+    sink = sum;
+    report("evaluate", ops, timer);
+}
+
+//Looks up the attacks from every square with the occupancy of every position
+void bench_slider_attacks(int rounds, bool rook)
+{
+    long int ops = 0;
+    unsigned long long sum = 0;
+    Timer timer;
+    for(int round = 0; round < rounds; round++)
+        for(Position *pos : positions)
+        {
+            Bitboard blockers = pos->current_state->blocker_bitboard;
+            for(int square = 0; square < 64; square++)
+                sum += rook ? rook_attack_bb((Square) square, blockers) : bishop_attack_bb((Square) square, blockers);
+            ops += 64;
+        }
+    sink = sum;
+    report(rook ? "rook_attack_bb" : "bishop_attack_bb", ops, timer);
+}
+
+//Random keys spread over a table larger than the caches, like in a real search
+void bench_tt(int rounds)
+{
+    const int NUM_KEYS = 1 << 16;
+    TranspositionTable table(1 << 22);
+    std::vector<Key> keys(NUM_KEYS);
+    Key key = 0x9E3779B97F4A7C15ull;
+    for(int i = 0; i < NUM_KEYS; i++)
+    {
+        key ^= key << 13;
+        key ^= key >> 7;
+        key ^= key << 17;
+        keys[i] = key;
+    }
+
+    //The first touch of a page is not what we want to measure
+    for(int i = 0; i < NUM_KEYS; i++)
+        table.store(keys[i], Exact, 0, NO_MOVE, 0, 0);
+
+    long int ops = 0;
+    Timer store_timer;
+    for(int round = 0; round < rounds; round++)
+        for(int i = 0; i < NUM_KEYS; i++)
+        {
+            table.store(keys[i], Exact, i, NO_MOVE, round + 1, round + 1);
+            ops++;
+        }
+    report("tt_store", ops, store_timer);
+
+    ops = 0;
+    unsigned long long sum = 0;
+    Timer probe_timer;
+    for(int round = 0; round < rounds; round++)
+        for(int i = 0; i < NUM_KEYS; i++)
+        {
+            TranspositionTableEntry *entry = table.get_entry(keys[i]);
+            sum += entry != nullptr ? entry->score : 0;
+            ops++;
+        }
+    sink = sum;
+    report("tt_get_entry", ops, probe_timer);
+}
+
+//Constructs a move picker and takes all moves from it, ops counts the moves
+void bench_move_picker(int rounds)
+{
+    SearchResult *res = new SearchResult();
+    long int ops = 0;
+    unsigned long long sum = 0;
+    Timer timer;
+    for(int round = 0; round < rounds; round++)
+        for(Position *pos : positions)
+        {
+            MovePicker mp(pos, nullptr, NO_MOVE, NO_MOVE, NO_MOVE, res, false);
+            Move move;
+            while((move = mp.next_move()) != NO_MOVE)
+            {
+                sum += move;
+                ops++;
+            }
+        }
+    sink = sum;
+    report("move_picker", ops, timer);
+    delete res;
+}
+
+int main(int argc, char **argv)
+{
+    int rounds = argc > 1 ? atoi(argv[1]) : 20000;
+    if(rounds <= 0)
+        rounds = 20000;
+
+    init_bitboards();
+    zobrist::init();
+    material::init();
+    endgame::init();
+    bitbase::init();
+    init_search();
+
+    for(int i = 0; i < bench::NUM_BENCH_POSITIONS; i++)
+    {
+        Position *pos = new Position();
+        std::string fen(bench::BENCH_POSITIONS[i]);
+        pos->init(fen);
+        positions.push_back(pos);
+
+        MoveList moves(pos, false);
+        std::vector<Move> legal;
+        for(int j = 0; j < moves.size; j++)
+            if(pos->is_legal(moves.moveList[j].move))
+                legal.push_back(moves.moveList[j].move);
+        legal_moves.push_back(legal);
+    }
+
+    bench_generate_moves(rounds, false);
+    bench_generate_moves(rounds, true);
+    bench_do_undo_move(rounds / 10 + 1);
+    bench_compute_bitboards(rounds);
+    bench_evaluate(rounds);
+    bench_slider_attacks(rounds / 10 + 1, true);
+    bench_slider_attacks(rounds / 10 + 1, false);
+    bench_tt(rounds / 100 + 1);
+    bench_move_picker(rounds / 10 + 1);
+
+    //cycles_per_op is 0 where there is no time stamp counter
+    printf("{\n  \"positions\": %i,\n  \"rounds\": %i,\n  \"benchmarks\": [\n", bench::NUM_BENCH_POSITIONS, rounds);
+    for(size_t i = 0; i < results.size(); i++)
+    {
+        Result &r = results[i];
+        printf("    {\"name\": \"%s\", \"ops\": %li, \"ns_per_op\": %.2f, \"cycles_per_op\": %.2f}%s\n",
+            r.name, r.ops, r.ns / r.ops, (double) r.cycles / r.ops, i + 1 < results.size() ? "," : "");
+    }
+    printf("  ]\n}\n");
+
+    return 0;
+}
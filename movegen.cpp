@@ -2,15 +2,20 @@
 
 #include "bitboards.h"
 #include "movegen.h"
+#include "trace.h"
 
 int PIECE_CAPTURE_VALUES[13] = {0, 1, 2, 2, 3, 4, 5, 1, 2, 2, 3, 4, 5 };
 
+//The generators are templated on the side to move, so the directions, ranks and casteling squares
+//are resolved at compile time. generate_moves dispatches once per call
+template<Color Us>
 MoveExt *add_king_moves(Position *pos, MoveExt *move_list, bool only_captures)
 {
-    Piece our_king = make_piece(KING, pos->color_to_move);
+    constexpr Color them = ~Us;
+    constexpr Piece our_king = make_piece(KING, Us);
     Square king_square = lsb(pos->piece_bitboard[our_king]);
-    Bitboard king_moves = king_attack_bb(king_square) & ~pos->current_state->attack_bitboards[~pos->color_to_move] & ~pos->color_bitboard[pos->color_to_move];
-    if(only_captures) king_moves &= pos->color_bitboard[~pos->color_to_move];
+    Bitboard king_moves = king_attack_bb(king_square) & ~pos->current_state->attack_bitboards[them] & ~pos->color_bitboard[Us];
+    if(only_captures) king_moves &= pos->color_bitboard[them];
     while (king_moves)
     {
         int target = pop_lsb(&king_moves);
@@ -22,56 +27,49 @@ MoveExt *add_king_moves(Position *pos, MoveExt *move_list, bool only_captures)
     return move_list;
 }
 
+template<Color Us>
 MoveExt *add_casteling_moves(Position *pos, MoveExt *move_list)
 {
-    if (pos->color_to_move == white)
+    constexpr Color them = ~Us;
+    constexpr Piece our_king = make_piece(KING, Us);
+    constexpr Square king_from = Us == white ? e1 : e8;
+    constexpr Square kingside_to = Us == white ? g1 : g8;
+    constexpr Square queenside_to = Us == white ? c1 : c8;
+    constexpr unsigned int kingside_right = Us == white ? WHITE_KINGSIDE_CASTELING : BLACK_KINGSIDE_CASTELING;
+    constexpr unsigned int queenside_right = Us == white ? WHITE_QUEENSIDE_CASTELING : BLACK_QUEENSIDE_CASTELING;
+    //The squares the king passes have to be free and not attacked, on the queenside the b-file square only has to be free
+    constexpr Bitboard kingside_path = Us == white ? (1ull << f1) | (1ull << g1) : (1ull << f8) | (1ull << g8);
+    constexpr Bitboard queenside_path = Us == white ? (1ull << c1) | (1ull << d1) : (1ull << c8) | (1ull << d8);
+    constexpr Bitboard queenside_free = queenside_path | (Us == white ? 1ull << b1 : 1ull << b8);
+
+    if(pos->current_state->casteling_rights & kingside_right)
     {
-        if(pos->current_state->casteling_rights & WHITE_KINGSIDE_CASTELING)
-        {
-            Bitboard f1_g1 = (1ull << f1) | (1ull << g1);
-            if ((f1_g1 & pos->current_state->attack_bitboards[~pos->color_to_move]) == 0 && (f1_g1 & pos->current_state->blocker_bitboard) == 0)
-                *move_list++ = MoveExt(make_move_casteling(e1, g1, WHITE_KING), 0);
-        }
-        if(pos->current_state->casteling_rights & WHITE_QUEENSIDE_CASTELING)
-        {
-            if(pos->board[e1] != WHITE_KING) printf("BRU");
-            Bitboard c1_d1 = (1ull << c1) | (1ull << d1);
-            Bitboard b1_c1_d1 = (1ull << b1) | c1_d1;
-            if ((c1_d1 & pos->current_state->attack_bitboards[~pos->color_to_move]) == 0 && (b1_c1_d1 & pos->current_state->blocker_bitboard) == 0)
-                *move_list++ = MoveExt(make_move_casteling(e1, c1, WHITE_KING), 0);
-        }
+        if ((kingside_path & pos->current_state->attack_bitboards[them]) == 0 && (kingside_path & pos->current_state->blocker_bitboard) == 0)
+            *move_list++ = MoveExt(make_move_casteling(king_from, kingside_to, our_king), 0);
     }
-    else
+    if(pos->current_state->casteling_rights & queenside_right)
     {
-        if(pos->current_state->casteling_rights & BLACK_KINGSIDE_CASTELING)
-        {
-            Bitboard f8_g8 = (1ull << f8) | (1ull << g8);
-            if ((f8_g8 & pos->current_state->attack_bitboards[~pos->color_to_move]) == 0 && (f8_g8 & pos->current_state->blocker_bitboard) == 0)
-                *move_list++ = MoveExt(make_move_casteling(e8, g8, BLACK_KING), 0);
-        }
-        if(pos->current_state->casteling_rights & BLACK_QUEENSIDE_CASTELING)
-        {
-            Bitboard c8_d8 = (1ull << c8) | (1ull << d8);
-            Bitboard b8_c8_d8 = (1ull << b8) | c8_d8;
-            if ((c8_d8 & pos->current_state->attack_bitboards[~pos->color_to_move]) == 0 && (b8_c8_d8 & pos->current_state->blocker_bitboard) == 0)
-                *move_list++ = MoveExt(make_move_casteling(e8, c8, BLACK_KING), 0);
-        }
+        if ((queenside_path & pos->current_state->attack_bitboards[them]) == 0 && (queenside_free & pos->current_state->blocker_bitboard) == 0)
+            *move_list++ = MoveExt(make_move_casteling(king_from, queenside_to, our_king), 0);
     }
     return move_list;
 }
 
+template<Color Us>
 MoveExt *add_slider_moves(Position *pos, MoveExt *move_list, bool only_captures)
 {
+    constexpr Color them = ~Us;
+
     //Queens count as bishops and rooks
-    Bitboard bishops = pos->piece_bitboard[make_piece(BISHOP, pos->color_to_move)] | pos->piece_bitboard[make_piece(QUEEN, pos->color_to_move)];
+    Bitboard bishops = pos->piece_bitboard[make_piece(BISHOP, Us)] | pos->piece_bitboard[make_piece(QUEEN, Us)];
 
-    Bitboard rooks = pos->piece_bitboard[make_piece(ROOK, pos->color_to_move)] | pos->piece_bitboard[make_piece(QUEEN, pos->color_to_move)];
+    Bitboard rooks = pos->piece_bitboard[make_piece(ROOK, Us)] | pos->piece_bitboard[make_piece(QUEEN, Us)];
 
     while (bishops)
     {
         Square bishop_square = pop_lsb(&bishops);
-        Bitboard bishop_attacks = bishop_attack_bb(bishop_square, pos->current_state->blocker_bitboard) & pos->current_state->checker_bitboard & ~pos->color_bitboard[pos->color_to_move];
-        if(only_captures) bishop_attacks &= pos->color_bitboard[~pos->color_to_move];
+        Bitboard bishop_attacks = bishop_attack_bb(bishop_square, pos->current_state->blocker_bitboard) & pos->current_state->checker_bitboard & ~pos->color_bitboard[Us];
+        if(only_captures) bishop_attacks &= pos->color_bitboard[them];
         while (bishop_attacks)
         {
             Square target = pop_lsb(&bishop_attacks);
@@ -84,8 +82,8 @@ MoveExt *add_slider_moves(Position *pos, MoveExt *move_list, bool only_captures)
     while (rooks)
     {
         Square rook_square = pop_lsb(&rooks);
-        Bitboard rook_attacks = rook_attack_bb(rook_square, pos->current_state->blocker_bitboard) & pos->current_state->checker_bitboard & ~pos->color_bitboard[pos->color_to_move];
-        if(only_captures) rook_attacks &= pos->color_bitboard[~pos->color_to_move];
+        Bitboard rook_attacks = rook_attack_bb(rook_square, pos->current_state->blocker_bitboard) & pos->current_state->checker_bitboard & ~pos->color_bitboard[Us];
+        if(only_captures) rook_attacks &= pos->color_bitboard[them];
         while (rook_attacks)
         {
             Square target = pop_lsb(&rook_attacks);
@@ -98,9 +96,11 @@ MoveExt *add_slider_moves(Position *pos, MoveExt *move_list, bool only_captures)
     return move_list;
 }
 
+template<Color Us>
 MoveExt *add_knight_moves(Position *pos, MoveExt *move_list, bool only_captures)
 {
-    Piece our_knight = make_piece(KNIGHT, pos->color_to_move);
+    constexpr Color them = ~Us;
+    constexpr Piece our_knight = make_piece(KNIGHT, Us);
     //Pinned knights cannot move
     Bitboard knights = pos->piece_bitboard[our_knight] & ~pos->current_state->pinner_bitboard;
 
@@ -108,8 +108,8 @@ MoveExt *add_knight_moves(Position *pos, MoveExt *move_list, bool only_captures)
     {
         Square knight_square = pop_lsb(&knights);
         //We need to evade checks
-        Bitboard targets = knight_attack_bb(knight_square) & pos->current_state->checker_bitboard & ~pos->color_bitboard[pos->color_to_move];
-        if(only_captures) targets &= pos->color_bitboard[~pos->color_to_move];
+        Bitboard targets = knight_attack_bb(knight_square) & pos->current_state->checker_bitboard & ~pos->color_bitboard[Us];
+        if(only_captures) targets &= pos->color_bitboard[them];
         while (targets)
         {
             Square target = pop_lsb(&targets);
@@ -122,9 +122,10 @@ MoveExt *add_knight_moves(Position *pos, MoveExt *move_list, bool only_captures)
     return move_list;
 }
 
+template<Color Us>
 inline MoveExt *make_promotions(Position *pos, Square from, Square to, MoveExt *move_list)
 {
-    Piece our_pawn = make_piece(PAWN, pos->color_to_move);
+    constexpr Piece our_pawn = make_piece(PAWN, Us);
     Piece captured = pos->board[to];
     int score = captured ? PIECE_CAPTURE_VALUES[captured] * 10000000 - PIECE_CAPTURE_VALUES[our_pawn] * 1000000 : 0;
     move_list[0] = MoveExt(make_move_promotion(from, to, our_pawn, captured, QUEEN), score + 4);
@@ -135,31 +136,42 @@ inline MoveExt *make_promotions(Position *pos, Square from, Square to, MoveExt *
     return move_list + 4;
 }
 
+template<Color Us>
 MoveExt *add_pawn_moves(Position *pos, MoveExt *move_list, bool only_captures)
 {
     //ASSERT(pos->current_state->checker_bitboard);
 
-    Piece our_pawn = make_piece(PAWN, pos->color_to_move);
+    constexpr Color them = ~Us;
+    constexpr Piece our_pawn = make_piece(PAWN, Us);
 
-    Direction forwards = pos->color_to_move == white ? N : S;
+    constexpr Direction forwards = Us == white ? N : S;
+    constexpr Direction forwards_west = Us == white ? NW : SW;
+    constexpr Direction forwards_east = Us == white ? NE : SE;
+    //The pawns that moved once can move again from this rank
+    constexpr Square double_push_rank = Us == white ? a4 : a5;
 
     Bitboard en_passent_target = pos->current_state->en_passent != NO_SQUARE ? (1ull << pos->current_state->en_passent) : 0ull;
 
-    Bitboard pawns = pos->piece_bitboard[make_piece(PAWN, pos->color_to_move)];
+    Bitboard pawns = pos->piece_bitboard[our_pawn];
+
+    //En passent also evades the check of the pawn which just moved two squares
+    Bitboard evasions = pos->current_state->checker_bitboard;
+    if(en_passent_target && get_square(evasions, pos->current_state->en_passent - forwards))
+        evasions |= en_passent_target;
 
     //Capture-Moves
-    Bitboard westward_attacks = pos->color_to_move == white ? shift<NW>(pawns) : shift<SW>(pawns);
+    Bitboard westward_attacks = shift<forwards_west>(pawns);
     //We need to evade checks
-    westward_attacks &= pos->current_state->checker_bitboard & (pos->color_bitboard[~pos->color_to_move] | en_passent_target);
+    westward_attacks &= evasions & (pos->color_bitboard[them] | en_passent_target);
 
-    Bitboard eastward_attacks = pos->color_to_move == white ? shift<NE>(pawns) : shift<SE>(pawns);
+    Bitboard eastward_attacks = shift<forwards_east>(pawns);
     //We need to evade checks
-    eastward_attacks &= pos->current_state->checker_bitboard & (pos->color_bitboard[~pos->color_to_move] | en_passent_target);
+    eastward_attacks &= evasions & (pos->color_bitboard[them] | en_passent_target);
 
     while (westward_attacks)
     {
         Square target = pop_lsb(&westward_attacks);
-        Square from = target - forwards - W;
+        Square from = target - forwards_west;
         if (target > 7 && target < 56)
         {
             if (target == pos->current_state->en_passent)
@@ -173,14 +185,14 @@ MoveExt *add_pawn_moves(Position *pos, MoveExt *move_list, bool only_captures)
         }
         else
         {
-            move_list = make_promotions(pos, from, target, move_list);
+            move_list = make_promotions<Us>(pos, from, target, move_list);
         }
     }
 
     while (eastward_attacks)
     {
         Square target = pop_lsb(&eastward_attacks);
-        Square from = target - forwards - E;
+        Square from = target - forwards_east;
         if (target > 7 && target < 56)
         {
             if (target == pos->current_state->en_passent)
@@ -194,17 +206,17 @@ MoveExt *add_pawn_moves(Position *pos, MoveExt *move_list, bool only_captures)
         }
         else
         {
-            move_list = make_promotions(pos, from, target, move_list);
+            move_list = make_promotions<Us>(pos, from, target, move_list);
         }
     }
 
     if(only_captures) return move_list; //Early exit if in only capture mode
 
-    Bitboard forward_once = pos->color_to_move == white ? shift<N>(pawns) : shift<S>(pawns);
+    Bitboard forward_once = shift<forwards>(pawns);
     forward_once &= pos->current_state->free;
 
-    Bitboard forward_twice = pos->color_to_move == white ? shift<N>(forward_once) : shift<S>(forward_once);
-    forward_twice &= pos->current_state->free & rank_bitboards[pos->color_to_move == white ? 3 * 8 : 4 * 8];
+    Bitboard forward_twice = shift<forwards>(forward_once);
+    forward_twice &= pos->current_state->free & rank_bitboards[double_push_rank];
 
     forward_once &= pos->current_state->checker_bitboard;
     while (forward_once)
@@ -217,7 +229,7 @@ MoveExt *add_pawn_moves(Position *pos, MoveExt *move_list, bool only_captures)
         }
         else
         {
-            move_list = make_promotions(pos, from, target, move_list);
+            move_list = make_promotions<Us>(pos, from, target, move_list);
         }
     }
 
@@ -232,29 +244,37 @@ MoveExt *add_pawn_moves(Position *pos, MoveExt *move_list, bool only_captures)
     return move_list;
 }
 
+template<Color Us>
 MoveExt *generate_moves(Position *pos, MoveExt *move_list, bool only_captures)
 {
     //First, add the king moves
-    move_list = add_king_moves(pos, move_list, only_captures);
+    move_list = add_king_moves<Us>(pos, move_list, only_captures);
 
     //if in double check, stop here, because only king moves are valid
     if (pos->current_state->in_double_check)
         return move_list;
 
     //add slider moves
-    move_list = add_slider_moves(pos, move_list, only_captures);
+    move_list = add_slider_moves<Us>(pos, move_list, only_captures);
 
     //add knight moves
-    move_list = add_knight_moves(pos, move_list, only_captures);
+    move_list = add_knight_moves<Us>(pos, move_list, only_captures);
 
     //add pawn moves
-    move_list = add_pawn_moves(pos, move_list, only_captures);
+    move_list = add_pawn_moves<Us>(pos, move_list, only_captures);
     
     //if not in check, add casteling moves
     if (!pos->current_state->in_check && !only_captures) //Captures are never casteling moves
     {
-        move_list = add_casteling_moves(pos, move_list);
+        move_list = add_casteling_moves<Us>(pos, move_list);
     }
 
     return move_list;
-}
\ No newline at end of file
+}
+
+MoveExt *generate_moves(Position *pos, MoveExt *move_list, bool only_captures)
+{
+    TRACE_SCOPE(trace::MOVEGEN);
+    return pos->color_to_move == white ? generate_moves<white>(pos, move_list, only_captures)
+                                       : generate_moves<black>(pos, move_list, only_captures);
+}
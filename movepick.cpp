@@ -1,16 +1,18 @@
 #include "movepick.h"
 #include "io.h"
 #include "bitboards.h"
+#include "trace.h"
 
 #include <algorithm>
 
-MovePicker::MovePicker(Position *pos, TranspositionTableEntry *tte, Move killer0, Move killer1, SearchResult *res, bool only_captures)
+MovePicker::MovePicker(Position *pos, TranspositionTableEntry *tte, Move killer0, Move killer1, Move counter_move, SearchResult *res, bool only_captures)
 {
     this->tte = tte;
     this->stage = TT_MOVE;
     this->pos = pos;
     this->killer0 = killer0;
     this->killer1 = killer1;
+    this->counter_move = counter_move;
     this->res = res;
     this->only_captures = only_captures;
 }
@@ -22,6 +24,7 @@ MovePicker::~MovePicker()
 
 Move MovePicker::next_move()
 {
+    TRACE_SCOPE(trace::MOVE_PICKER);
     start:
     switch(stage)
     {
@@ -63,7 +66,9 @@ Move MovePicker::next_move()
             for(int index = 0; index < list->size; index++)
             {      
                 Move move = list->moveList[index].move;
-                list->moveList[index].score += res->CutoffHistory[from_square(move)][to_square(move)];
+                //The counter move is the first quiet move, the history sums up to less than 4 * HISTORY_MAX
+                if(is_quiet(move))
+                    list->moveList[index].score += quiet_move_score(res, pos, move) + (move == counter_move ? 4 * HISTORY_MAX : 0);
             }
             std::sort(list->moveList, list->moveList + list->size, [](const MoveExt &a, const MoveExt &b ) { return a.score > b.score; });
             goto start;
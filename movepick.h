@@ -11,10 +11,11 @@ enum Stage
 class MovePicker
 {
 public:
-    MovePicker(Position *pos, TranspositionTableEntry *tte, Move killer0, Move killer1, SearchResult *res, bool only_captures);
+    MovePicker(Position *pos, TranspositionTableEntry *tte, Move killer0, Move killer1, Move counter_move, SearchResult *res, bool only_captures);
     ~MovePicker();
     Move next_move();
     int legal_moves() {return this->num_legal_moves;}
+    Move killer(int index) {return index ? this->killer1 : this->killer0;}
     void reset() {stage = TT_MOVE; num_legal_moves = 0;}
 private:
     void pick_next_move();
@@ -24,6 +25,7 @@ private:
     Stage stage;
     Move killer0;
     Move killer1;
+    Move counter_move;
     MoveList *list = nullptr;
     int move_num = 0;
     int num_legal_moves = 0;
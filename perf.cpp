@@ -0,0 +1,150 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "perf.h"
+
+#ifdef PERF_COUNTERS
+
+#ifdef __linux__
+#include <errno.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+namespace perf
+{
+    const char *COUNTER_NAMES[NUM_COUNTERS] = {
+        "cycles", "instructions", "l1d_misses", "llc_misses", "dtlb_misses", "branch_misses"
+    };
+
+#ifdef __linux__
+    //The type and config of every counter for perf_event_open
+    const uint32_t TYPES[NUM_COUNTERS] = {
+        PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE
+    };
+
+    const uint64_t CONFIGS[NUM_COUNTERS] = {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+        PERF_COUNT_HW_CACHE_MISSES,
+        PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+        PERF_COUNT_HW_BRANCH_MISSES
+    };
+
+    //The error of the first counter which could not be opened, reported once
+    int open_error = 0;
+    bool open_error_reported = false;
+
+    int open_counter(Counter counter)
+    {
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = TYPES[counter];
+        attr.config = CONFIGS[counter];
+        attr.disabled = 1;
+        //More events than hardware counters are multiplexed by the kernel, the times allow to scale them
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        //Unprivileged users may only count their own user space code
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+
+        int fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        if(fd < 0 && !open_error)
+            open_error = errno;
+        return fd;
+    }
+
+    void start(Counters *counters)
+    {
+        for(int counter = 0; counter < NUM_COUNTERS; counter++)
+        {
+            counters->values[counter] = 0;
+            counters->running[counter] = 1.0;
+            counters->fds[counter] = open_counter((Counter) counter);
+        }
+
+        for(int counter = 0; counter < NUM_COUNTERS; counter++)
+        {
+            if(counters->fds[counter] < 0)
+                continue;
+            ioctl(counters->fds[counter], PERF_EVENT_IOC_RESET, 0);
+            ioctl(counters->fds[counter], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+
+    void stop(Counters *counters)
+    {
+        for(int counter = 0; counter < NUM_COUNTERS; counter++)
+        {
+            if(counters->fds[counter] < 0)
+                continue;
+            ioctl(counters->fds[counter], PERF_EVENT_IOC_DISABLE, 0);
+
+            //The value, the time the counter was enabled and the time it actually counted
+            uint64_t data[3];
+            if(read(counters->fds[counter], data, sizeof(data)) != sizeof(data) || data[2] == 0)
+            {
+                counters->values[counter] = 0;
+                counters->running[counter] = 0.0;
+            }
+            else
+            {
+                counters->running[counter] = (double) data[2] / data[1];
+                counters->values[counter] = data[2] < data[1] ? (uint64_t)((double) data[0] * data[1] / data[2]) : data[0];
+            }
+            close(counters->fds[counter]);
+        }
+    }
+#else
+    void start(Counters *counters)
+    {
+        for(int counter = 0; counter < NUM_COUNTERS; counter++)
+        {
+            counters->values[counter] = 0;
+            counters->running[counter] = 0.0;
+            counters->fds[counter] = -1;
+        }
+    }
+
+    void stop(Counters *) {}
+#endif
+
+    void report(Counters *counters, const char *name, uint64_t nodes)
+    {
+#ifdef __linux__
+        if(open_error && !open_error_reported)
+        {
+            printf("info string perf some counters are unavailable: %s (see /proc/sys/kernel/perf_event_paranoid)\n", strerror(open_error));
+            open_error_reported = true;
+        }
+#endif
+
+        for(int counter = 0; counter < NUM_COUNTERS; counter++)
+        {
+            if(counters->fds[counter] < 0)
+                printf("info string perf %s %s unavailable\n", name, COUNTER_NAMES[counter]);
+            else if(counters->running[counter] == 0.0)
+                printf("info string perf %s %s never counted (no free hardware counter)\n", name, COUNTER_NAMES[counter]);
+            else
+            {
+                printf("info string perf %s %s %llu per node %.2f", name, COUNTER_NAMES[counter],
+                    (unsigned long long) counters->values[counter],
+                    nodes > 0 ? (double) counters->values[counter] / nodes : 0.0);
+                //A multiplexed counter is an estimate from the time it counted
+                if(counters->running[counter] < 1.0)
+                    printf(" (scaled, counted %.1f%% of the time)", 100.0 * counters->running[counter]);
+                printf("\n");
+            }
+        }
+
+        if(counters->fds[CYCLES] >= 0 && counters->fds[INSTRUCTIONS] >= 0 && counters->values[CYCLES] > 0)
+            printf("info string perf %s ipc %.2f\n", name, (double) counters->values[INSTRUCTIONS] / counters->values[CYCLES]);
+        fflush(stdout);
+    }
+}
+
+#endif
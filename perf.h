@@ -0,0 +1,40 @@
+#ifndef PERF_H
+#define PERF_H
+
+#include <stdint.h>
+
+//Hardware performance counters (Linux perf_event_open) around perft and the search. Only compiled with
+//-DPERF_COUNTERS (make perf). Counters the kernel denies (see /proc/sys/kernel/perf_event_paranoid) or the
+//CPU lacks are reported as unavailable, the others still work
+#ifdef PERF_COUNTERS
+
+namespace perf
+{
+    enum Counter
+    {
+        CYCLES, INSTRUCTIONS, L1D_MISSES, LLC_MISSES, DTLB_MISSES, BRANCH_MISSES, NUM_COUNTERS
+    };
+
+    struct Counters
+    {
+        //-1 if the counter could not be opened
+        int fds[NUM_COUNTERS];
+        //Scaled up to the whole measured time if the kernel multiplexed the counter
+        uint64_t values[NUM_COUNTERS];
+        //Share of the measured time the counter was on the hardware, 1 if it was never multiplexed
+        double running[NUM_COUNTERS];
+    };
+
+    //Opens and starts the counters of the calling thread, user space only
+    void start(Counters *counters);
+
+    //Stops the counters, reads them and closes them
+    void stop(Counters *counters);
+
+    //Sends every counter in total and per node as info strings
+    void report(Counters *counters, const char *name, uint64_t nodes);
+}
+
+#endif
+
+#endif //!PERF_H
@@ -3,6 +3,7 @@
 #include "bitboards.h"
 #include "zobrist.h"
 #include "material.h"
+#include "trace.h"
 
 const char *SQUARE_NAMES_[64] = {
     "a1", "b1", "c1", "d1", "e1", "f1", "g1", "h1",
@@ -106,7 +107,19 @@ bool Position::is_legal(Move move)
 
     ASSERT(a1 <= start && start <= h8);
     ASSERT(a1 <= target && target <= h8);
-    
+
+    //En passent removes two pawns from the board, which the pins do not cover (e.g. both pawns on the rank of the king)
+    if(is_en_passent(move))
+    {
+        Color them = ~this->color_to_move;
+        Square king_square = lsb(this->piece_bitboard[make_piece(KING, this->color_to_move)]);
+        Square captured_square = this->color_to_move == white ? target - N : target + N;
+        Bitboard blockers = (this->current_state->blocker_bitboard & ~(1ull << start) & ~(1ull << captured_square)) | (1ull << target);
+        Bitboard queens = this->piece_bitboard[make_piece(QUEEN, them)];
+        return !(rook_attack_bb(king_square, blockers) & (this->piece_bitboard[make_piece(ROOK, them)] | queens))
+            && !(bishop_attack_bb(king_square, blockers) & (this->piece_bitboard[make_piece(BISHOP, them)] | queens));
+    }
+
     if(get_square(this->current_state->pinner_bitboard, start))
     {
         //We are not a king or a knight (this is already checked in generate)
@@ -149,7 +162,8 @@ inline void add_piece(Position *pos, Square square, Piece piece, Key *position_k
     pos->material[piece]++;
 }
 
-void create_attack_bitboard(Position *pos, Color color)
+template<Color color>
+void create_attack_bitboard(Position *pos)
 {
     Piece opponent_king = make_piece(KING, ~color);
     Square opponent_king_square = lsb(pos->piece_bitboard[opponent_king]);
@@ -185,7 +199,9 @@ void create_attack_bitboard(Position *pos, Color color)
         pos->current_state->attack_bitboards[color] |= rook_attack_bb(rook_square, blockers_without_king);
     }
 
-    pos->current_state->pawn_attack_bitboards[color] = color == white ? shift<NE>(pawns) | shift<NW>(pawns) : shift<SE>(pawns) | shift<SW>(pawns);
+    constexpr Direction forwards_west = color == white ? NW : SW;
+    constexpr Direction forwards_east = color == white ? NE : SE;
+    pos->current_state->pawn_attack_bitboards[color] = shift<forwards_east>(pawns) | shift<forwards_west>(pawns);
     pos->current_state->attack_bitboards[color] |= pos->current_state->pawn_attack_bitboards[color];
 
     pos->current_state->attack_bitboards[color] |= king_attack_bb(our_king_square);
@@ -193,8 +209,18 @@ void create_attack_bitboard(Position *pos, Color color)
 
 void Position::compute_bitboards()
 {
-    Color them = ~this->color_to_move;
-    Piece our_king = make_piece(KING, this->color_to_move);
+    if(this->color_to_move == white)
+        this->compute_bitboards<white>();
+    else
+        this->compute_bitboards<black>();
+}
+
+template<Color Us>
+void Position::compute_bitboards()
+{
+    TRACE_SCOPE(trace::COMPUTE_BITBOARDS);
+    constexpr Color them = ~Us;
+    constexpr Piece our_king = make_piece(KING, Us);
     Square our_king_square = lsb(this->piece_bitboard[our_king]);
 
     this->current_state->in_check = 0;
@@ -204,8 +230,8 @@ void Position::compute_bitboards()
     this->current_state->free = ~(this->color_bitboard[white] | this->color_bitboard[black]);
     this->current_state->blocker_bitboard = ~this->current_state->free;
 
-    create_attack_bitboard(this, white);
-    create_attack_bitboard(this, black);
+    create_attack_bitboard<white>(this);
+    create_attack_bitboard<black>(this);
 
     if(this->current_state->attack_bitboards[them] & this->piece_bitboard[our_king]){
         //We are in check, calculate checkers
@@ -217,7 +243,7 @@ void Position::compute_bitboards()
             this->current_state->checker_bitboard |= knight_checks;
         }
 
-        Bitboard pawn_checks = pawn_attack_bb(this->color_to_move, our_king_square) & this->piece_bitboard[make_piece(PAWN, them)];
+        Bitboard pawn_checks = pawn_attack_bb(Us, our_king_square) & this->piece_bitboard[make_piece(PAWN, them)];
         if(pawn_checks)
         {
             this->current_state->in_double_check = this->current_state->in_check;
@@ -245,7 +271,7 @@ void Position::compute_bitboards()
         Piece attacker = this->board[attacker_square];
         if(attacker == make_piece(BISHOP, them) || attacker == make_piece(QUEEN, them))
         {
-            int num_pinned = popcount(ray_bitboards[our_king_square][attacker_square] & this->color_bitboard[this->color_to_move]);
+            int num_pinned = popcount(ray_bitboards[our_king_square][attacker_square] & this->color_bitboard[Us]);
             if(num_pinned == 1)
             {
                 //Pin this ray if there is exactly one of our pieces, and the enemy attacks along it
@@ -273,7 +299,7 @@ void Position::compute_bitboards()
         Piece attacker = this->board[attacker_square];
         if(attacker == make_piece(ROOK, them) || attacker == make_piece(QUEEN, them))
         {   
-            int num_pinned = popcount(ray_bitboards[our_king_square][attacker_square] & this->color_bitboard[this->color_to_move]);
+            int num_pinned = popcount(ray_bitboards[our_king_square][attacker_square] & this->color_bitboard[Us]);
             if(num_pinned == 1)
             {
                 //Pin this ray if there is exactly one of our pieces, and the enemy attacks along it
@@ -294,6 +320,16 @@ void Position::compute_bitboards()
 
 void Position::do_move(Move move)
 {
+    if(this->color_to_move == white)
+        this->do_move<white>(move);
+    else
+        this->do_move<black>(move);
+}
+
+template<Color Us>
+void Position::do_move(Move move)
+{
+    constexpr Color them = ~Us;
     Square to = to_square(move);
     Square from = from_square(move);
     Piece moved = moved_piece(move);
@@ -343,7 +379,7 @@ void Position::do_move(Move move)
     {
         //Add promoted piece to target
         PieceType promoted = promoted_piece(move);
-        Piece promoted_piece = make_piece(promoted, this->color_to_move);
+        Piece promoted_piece = make_piece(promoted, Us);
         add_piece(this, to, promoted_piece, &state->position_key, &state->material_key);
 
         //This can lead to a non-standard material config
@@ -359,7 +395,7 @@ void Position::do_move(Move move)
     if(is_double_pawn(move))
     {
         //We need to set the en_passent square to the square behind the pawn
-        state->en_passent = this->color_to_move == white ? from + N : from - N;
+        state->en_passent = Us == white ? from + N : from - N;
         zobrist::change_en_passent(&state->position_key, state->en_passent);
     }
     else
@@ -371,18 +407,18 @@ void Position::do_move(Move move)
     if(is_en_passent(move))
     {
         //Remove the pawn from the square in front of the en_passent square
-        Square capture_square = (Square)(8 * (from / 8) + (to % 8)); //this->color_to_move == white ? to - N : to + N;
+        Square capture_square = (Square)(8 * (from / 8) + (to % 8)); //Us == white ? to - N : to + N;
         ASSERT((3 <= capture_square / 8) && (capture_square / 8 <= 4));
         remove_piece(this, capture_square, &state->position_key, &state->material_key);
         en_passent_moves++;
     }
 
-    if(CASTELING[this->color_to_move] & state->casteling_rights)
+    if(CASTELING[Us] & state->casteling_rights)
     {
         //Revoke casteling rights
         if(moved_pt == KING)
         {
-            state->casteling_rights &= CASTELING[~this->color_to_move];
+            state->casteling_rights &= CASTELING[them];
         }
         else if(moved_pt == ROOK)
         {
@@ -438,11 +474,11 @@ void Position::do_move(Move move)
 
     zobrist::change_casteling(&state->position_key, state->casteling_rights);
     zobrist::change_color_to_move(&state->position_key);
-    this->color_to_move = ~this->color_to_move;
+    this->color_to_move = them;
     this->current_state = state;
 
     //Setup attack/checker/blocker bitboards
-    this->compute_bitboards();
+    this->compute_bitboards<them>();
 }
 
 void Position::undo_move()
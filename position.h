@@ -58,8 +58,13 @@ struct Position {
 
     bool is_legal(Move move);
     bool is_pseudo_legal(Move move);
-private:
+
+    //Recomputes the attack, pin and check bitboards of the current state. Public for the microbenchmarks
     void compute_bitboards();
+
+    //Implementations for a fixed color to move, the functions above dispatch to them
+    template<Color Us> void do_move(Move move);
+    template<Color Us> void compute_bitboards();
 };
 
 #endif //!POSITION_H
\ No newline at end of file
@@ -1,17 +1,107 @@
+#include <algorithm>
 #include <chrono>
+#include <cmath>
 #include <thread>
 
+//The search defines its own INFINITY score
+#undef INFINITY
+
 #include "search.h"
 #include "evaluation.h"
 #include "movegen.h"
 #include "movepick.h"
 #include "material.h"
+#include "endgame.h"
+#include "syzygy.h"
+#include "timeman.h"
 #include "tt.h"
+#include "trace.h"
+#include "perf.h"
 #include "uci.h"
 
 const int NULL_MOVE_DEPTH_REDUCTION = 3;
 
 TranspositionTable *tt = nullptr;
+SearchController search_controller;
+
+Depth reductions[LMR_TABLE_SIZE][LMR_TABLE_SIZE];
+
+PruningOptions pruning_options = { true, true, true, HASH_MOVE_IIR };
+
+//The search data of the current game. The history tables and killers are kept between the moves
+SearchResult *game_result = nullptr;
+
+//The table and search data of the game while it is suspended
+TranspositionTable *suspended_tt = nullptr;
+SearchResult *suspended_game_result = nullptr;
+
+void SearchController::start(SearchLimits *limits)
+{
+    this->limits = *limits;
+    this->start_time = std::chrono::steady_clock::now();
+    this->soft_time_factor = 1.0f;
+    this->pondering.store(limits->ponder);
+    this->ponderhit_received.store(false);
+    this->stop.store(false);
+}
+
+void SearchController::ponderhit()
+{
+    this->ponderhit_received.store(true);
+}
+
+void SearchController::update_ponder()
+{
+    //Our clock starts running when the opponent makes the expected move
+    if(this->pondering.load(std::memory_order_relaxed) && this->ponderhit_received.load())
+    {
+        this->start_time = std::chrono::steady_clock::now();
+        this->pondering.store(false);
+    }
+}
+
+void SearchController::wait_for_stop()
+{
+    while(!this->stop.load()
+        && (this->limits.infinite || (this->pondering.load() && !this->ponderhit_received.load())))
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
+
+int SearchController::elapsed()
+{
+    using namespace std::chrono;
+    return (int) duration_cast<milliseconds>(steady_clock::now() - this->start_time).count();
+}
+
+void SearchController::poll(long int nodes)
+{
+    this->update_ponder();
+
+    if((this->limits.nodes && nodes >= this->limits.nodes)
+        || (!this->pondering.load(std::memory_order_relaxed) && this->limits.hard_time >= 0 && this->elapsed() >= this->limits.hard_time))
+        this->stop.store(true, std::memory_order_relaxed);
+}
+
+bool SearchController::soft_limit_reached()
+{
+    this->update_ponder();
+
+    if(this->limits.soft_time < 0 || this->pondering.load())
+        return false;
+
+    int soft_time = (int)(this->limits.soft_time * this->soft_time_factor);
+    if(this->limits.hard_time >= 0 && soft_time > this->limits.hard_time)
+        soft_time = this->limits.hard_time;
+    return this->elapsed() >= soft_time;
+}
+
+//Polls the controller every CHECK_INTERVAL nodes, returns true if the search has to stop
+inline bool should_stop(SearchResult *res)
+{
+    if((res->nodes & (CHECK_INTERVAL - 1)) == 0)
+        search_controller.poll(res->total_nodes + res->nodes);
+    return search_controller.stop.load(std::memory_order_relaxed);
+}
 
 /*void pick_init(MoveList *list, Position *pos, SearchResult *res, TranspositionTableEntry *tte)
 {
@@ -35,6 +125,82 @@ void add_killer(Position *pos, SearchResult *res, Move killer)
     res->killers[0][pos->current_state->ply] = killer;
 }
 
+int quiet_move_score(SearchResult *res, Position *pos, Move move)
+{
+    int score = res->history[pos->color_to_move][from_square(move)][to_square(move)];
+
+    State *s = pos->current_state;
+    if(s->move != NO_MOVE)
+        score += res->continuation_history[moved_piece(s->move)][to_square(s->move)][moved_piece(move)][to_square(move)];
+    if(s->last_state != nullptr && s->last_state->move != NO_MOVE)
+        score += res->continuation_history[moved_piece(s->last_state->move)][to_square(s->last_state->move)][moved_piece(move)][to_square(move)];
+
+    return score;
+}
+
+Move countermove(SearchResult *res, Position *pos)
+{
+    Move last_move = pos->current_state->move;
+    return last_move == NO_MOVE ? NO_MOVE : res->countermoves[moved_piece(last_move)][to_square(last_move)];
+}
+
+//Deeper cutoffs are worth more
+inline int history_bonus(Depth depth)
+{
+    return std::min(32 * depth * depth, HISTORY_MAX / 8);
+}
+
+//Gravity: the entry approaches +-HISTORY_MAX, the closer it gets the less it changes
+inline void update_history_entry(int *entry, int bonus)
+{
+    *entry += bonus - *entry * abs(bonus) / HISTORY_MAX;
+}
+
+void update_quiet_histories(SearchResult *res, Position *pos, Move move, int bonus)
+{
+    update_history_entry(&res->history[pos->color_to_move][from_square(move)][to_square(move)], bonus);
+
+    State *s = pos->current_state;
+    if(s->move != NO_MOVE)
+        update_history_entry(&res->continuation_history[moved_piece(s->move)][to_square(s->move)][moved_piece(move)][to_square(move)], bonus);
+    if(s->last_state != nullptr && s->last_state->move != NO_MOVE)
+        update_history_entry(&res->continuation_history[moved_piece(s->last_state->move)][to_square(s->last_state->move)][moved_piece(move)][to_square(move)], bonus);
+}
+
+//A quiet move caused a cutoff: reward it, punish the quiet moves searched before it
+void update_quiet_cutoff(SearchResult *res, Position *pos, Move move, Depth depth, Move *quiets_searched, int num_quiets_searched)
+{
+    int bonus = history_bonus(depth);
+    update_quiet_histories(res, pos, move, bonus);
+    for(int i = 0; i < num_quiets_searched; i++)
+        update_quiet_histories(res, pos, quiets_searched[i], -bonus);
+
+    Move last_move = pos->current_state->move;
+    if(last_move != NO_MOVE)
+        res->countermoves[moved_piece(last_move)][to_square(last_move)] = move;
+}
+
+//The best move first, the remaining moves by the size of their subtree
+bool compare_root_moves(const RootMove &a, const RootMove &b)
+{
+    return a.score != b.score ? a.score > b.score : a.nodes > b.nodes;
+}
+
+//Prepends move to the PV of the child node
+inline void update_pv(SearchResult *res, int height, Move move)
+{
+    if(height >= MAX_PV_LENGTH - 1)
+        return;
+
+    Move *pv = res->pv_table[height];
+    int child_length = height + 1 < MAX_PV_LENGTH - 1 ? res->pv_table_length[height + 1] : 0;
+
+    pv[0] = move;
+    for(int i = 0; i < child_length; i++)
+        pv[i + 1] = res->pv_table[height + 1][i];
+    res->pv_table_length[height] = child_length + 1;
+}
+
 /*void pick_next_move(int move_num, MoveList *list) {
 	MoveExt temp;
 	int index = 0;
@@ -56,33 +222,162 @@ void add_killer(Position *pos, SearchResult *res, Move killer)
 	list->moveList[bestNum] = temp;
 }*/
 
-void do_search(Depth min_depth, Depth max_depth, Position *pos, int timeleft)
+void init_search()
+{
+    //Late moves at high depth are reduced the most, the reduction grows with the logarithm of both
+    for(int depth = 1; depth < LMR_TABLE_SIZE; depth++)
+        for(int move_num = 1; move_num < LMR_TABLE_SIZE; move_num++)
+            reductions[depth][move_num] = (Depth)(0.75 + std::log(depth) * std::log(move_num) / 2.25);
+}
+
+//Number of quiet moves searched at shallow depth before the remaining quiet moves are skipped
+inline int move_count_limit(Depth depth, bool improving)
+{
+    return improving ? 3 + depth * depth : (3 + depth * depth) / 2;
+}
+
+//A path is extended by at most half the depth of the iteration, so that checks and recaptures cannot explode a line
+inline int extension_budget(SearchResult *res)
+{
+    return std::max(MIN_EXTENSION_BUDGET, res->search_depth / 2);
+}
+
+//The move captures back on the square where the opponent just captured. Called after the move is made
+inline bool is_recapture(Position *pos, Move move)
+{
+    Move last_move = pos->current_state->last_state->move;
+    return captured_piece(move)
+        && last_move != NO_MOVE
+        && captured_piece(last_move)
+        && to_square(last_move) == to_square(move);
+}
+
+void new_game()
+{
+    delete game_result;
+    game_result = new SearchResult();
+}
+
+void set_hash_size(int megabytes)
+{
+    //The number of entries has to be a power of 2
+    size_t num_entries = 1;
+    while(2 * num_entries * sizeof(TranspositionTableEntry) <= (size_t) megabytes * 1024 * 1024)
+        num_entries *= 2;
+
+    delete tt;
+    tt = new TranspositionTable(num_entries);
+}
+
+void clear_hash()
+{
+    if(tt != nullptr)
+        tt->clear();
+}
+
+void suspend_game()
+{
+    suspended_tt = tt;
+    suspended_game_result = game_result;
+    tt = nullptr;
+    game_result = nullptr;
+}
+
+void resume_game()
+{
+    delete tt;
+    delete game_result;
+    tt = suspended_tt;
+    game_result = suspended_game_result;
+    suspended_tt = nullptr;
+    suspended_game_result = nullptr;
+}
+
+long int searched_nodes()
+{
+    return game_result != nullptr ? game_result->total_nodes : 0;
+}
+
+//The history of older searches counts less, so that the move ordering adapts to the new position
+void age_history(SearchResult *res)
+{
+    int *history = &res->history[0][0][0];
+    for(size_t i = 0; i < sizeof(res->history) / sizeof(int); i++)
+        history[i] /= 2;
+
+    int *continuation_history = &res->continuation_history[0][0][0][0];
+    for(size_t i = 0; i < sizeof(res->continuation_history) / sizeof(int); i++)
+        continuation_history[i] /= 2;
+}
+
+void do_search(Depth min_depth, Position *pos)
 {
     using namespace std::chrono;
-    long int total_nodes = 0;
     
     if(tt == nullptr)
         tt = new TranspositionTable(1 << 25); //512 MB 
 
-    SearchResult *res = new SearchResult();
+    if(game_result == nullptr)
+        new_game();
+
+    SearchResult *res = game_result;
     res->start_ply = pos->current_state->ply;
-    res->aborted = false;
+    res->score = 0;
+    res->total_nodes = 0;
+    res->tb_hits = 0;
+    res->extensions[res->start_ply] = 0;
+    age_history(res);
+
+#ifdef TRACE
+    trace::reset();
+#endif
+#ifdef PERF_COUNTERS
+    perf::Counters counters;
+    perf::start(&counters);
+#endif
+
+    //The first iteration searches the root moves in the order of the move generator
+    MoveList moves(pos, false);
+    std::stable_sort(moves.moveList, moves.moveList + moves.size, [](const MoveExt &a, const MoveExt &b) { return a.score > b.score; });
+
+    Move legal_moves[256];
+    int num_legal_moves = 0;
+    for(int i = 0; i < moves.size; i++)
+        if(pos->is_legal(moves.moveList[i].move))
+            legal_moves[num_legal_moves++] = moves.moveList[i].move;
+
+    //Keep only the root moves which preserve the tablebase result, the search does not probe then
+    res->root_in_tb = false;
+    if(syzygy::max_pieces
+        && popcount(pos->color_bitboard[white] | pos->color_bitboard[black]) <= syzygy::max_pieces
+        && !pos->current_state->casteling_rights)
+    {
+        res->root_in_tb = syzygy::root_probe(pos, legal_moves, &num_legal_moves);
+    }
+
+    res->num_root_moves = num_legal_moves;
+    for(int i = 0; i < num_legal_moves; i++)
+        res->root_moves[i] = { legal_moves[i], -INFINITY, 0 };
+
+    //Play the first legal move if not even the first iteration finishes. Without one (mate, stalemate) the
+    //root moves are left over from the last search, so there is no move to play
+    res->pv[0] = num_legal_moves > 0 ? res->root_moves[0].move : NO_MOVE;
+    res->pv_length = num_legal_moves > 0 ? 1 : 0;
 
-    //Abort the search after timeleft milliseconds
-    std::thread t([=]() {
-        std::this_thread::sleep_for(milliseconds(timeleft));
-        res->aborted = true;
-    });
-    t.detach();
+    int stable_iterations = 0;
+    STATS(long int last_iteration_nodes = 0);
 
     high_resolution_clock::time_point start = high_resolution_clock::now();
-    for(int depth = min_depth; depth < max_depth; depth++)
+    for(int depth = min_depth; depth <= search_controller.limits.depth; depth++)
     {
         res->search_depth = depth;
 
         int delta = 17;
         int alpha = depth == min_depth ? -INFINITY : res->score - delta;
         int beta = depth == min_depth ? INFINITY : res->score + delta;
+        int aspiration_failures = 0;
+        bool failed_low = false;
+        STATS(res->stats = SearchStats());
 
         while(true) {
             //Reset search result data
@@ -91,46 +386,70 @@ void do_search(Depth min_depth, Depth max_depth, Position *pos, int timeleft)
             res->nodes = 0;
 
             res->score = search<PV>(depth, alpha, beta, pos, res);
-            total_nodes += res->nodes;
-            
-            if(alpha < res->score && res->score < beta)
+            res->total_nodes += res->nodes;
+            STATS(res->stats.nodes += res->nodes);
+
+            //Search the best move first in the next iteration (or after the window was widened)
+            if(!search_controller.stop)
+                std::stable_sort(res->root_moves, res->root_moves + res->num_root_moves, compare_root_moves);
+
+            if(search_controller.stop || (alpha < res->score && res->score < beta))
             {
                 break;
             }
+            aspiration_failures++;
+            STATS(res->stats.aspiration_researches++);
+            if(res->score <= alpha)
+                failed_low = true;
+
             delta = delta * 5 / 4;
             alpha = res->score - delta;
             beta = res->score + delta;
-            printf("Aspiration window failed, new delta: %i, score:%i\n", delta, res->score);
         }
 
-        if(!res->aborted)
-            //Setup pv for next iteration
-            res->pv_length = tt->find_pv(pos, res->pv);
+        //The result of an aborted iteration is not reliable
+        if(search_controller.stop)
+            break;
+
+        //The PV of the root is empty if no move raised alpha, e.g. because the root was pruned
+        Move last_best_move = res->pv[0];
+        if(res->pv_table_length[0] > 0)
+        {
+            res->pv_length = res->pv_table_length[0];
+            for(int i = 0; i < res->pv_length; i++)
+                res->pv[i] = res->pv_table[0][i];
+        }
+        stable_iterations = depth > min_depth && res->pv[0] == last_best_move ? stable_iterations + 1 : 0;
+        search_controller.soft_time_factor = timeman::soft_time_factor(stable_iterations, aspiration_failures, failed_low);
 
         high_resolution_clock::time_point end = high_resolution_clock::now();
         duration<double, std::milli> time_span = end - start;
 
-        if(!res->aborted)
-        {
-            uci::send_depth_info(res, (int) 1000 * (total_nodes / time_span.count()));
-            uci::send_hashtable_info(tt->get_used_percentage());
-            printf("Used: %i, Collisions: %i, Hits: %i\n", tt->get_used(), tt->collissions, tt->hits);
-            //printf("info string hashcolissions %i used %i hits %i\n", tt->collissions, tt->get_used(), tt->hits);
-            //printf("info string ordering %.2f\n", res->fhf / (float) res->fh);
-        }
+        uci::send_depth_info(res, (int) 1000 * (res->total_nodes / time_span.count()));
+        uci::send_hashtable_info(tt->get_used_percentage());
+        STATS(uci::send_search_stats(res, last_iteration_nodes));
+        STATS(last_iteration_nodes = res->stats.nodes);
 
-        //TODO calculate remaining time from timeleft
-        if(res->aborted) {
+        //Do not start an iteration which we probably cannot finish
+        if(search_controller.soft_limit_reached())
             break;
-        }
     }
 
+#ifdef TRACE
+    trace::report();
+#endif
+#ifdef PERF_COUNTERS
+    perf::stop(&counters);
+    perf::report(&counters, "search", res->total_nodes);
+#endif
+
+    //The GUI expects no best move before stop or ponderhit in these modes
+    search_controller.wait_for_stop();
+
     uci::send_best_move(res->pv[0]);
-    pos->do_move(res->pv[0]);
 
     //Free the tt memory
     //delete tt;
-    delete res;
 }
 
 template<NodeType T>
@@ -138,7 +457,11 @@ int search(Depth depth, int alpha, int beta, Position *pos, SearchResult *res)
 {
     res->nodes++;
 
-    if(res->aborted)
+    int height = pos->current_state->ply - res->start_ply;
+    if(height < MAX_PV_LENGTH)
+        res->pv_table_length[height] = 0;
+
+    if(should_stop(res))
         return DRAW;
     
     //50 moves rule draw detection
@@ -161,29 +484,138 @@ int search(Depth depth, int alpha, int beta, Position *pos, SearchResult *res)
     }
 
 
+    //Known draws (e.g. from the KPK bitbase) need no search, but we still need a move at the root
+    if(pos->current_state->ply != res->start_ply && endgame::is_known_draw(pos))
+    {
+        return DRAW;
+    }
+
     if(depth <= 0 || pos->current_state->ply - res->start_ply >= 2 * res->search_depth)
     {
         return qsearch(alpha, beta, pos, res);
     }
 
+    //The move excluded by a singular extension search of this node, the search must neither cut with nor store
+    //its results in the transposition table then
+    Move excluded_move = res->excluded_moves[pos->current_state->ply];
+
     //Tablebase probe. TODO is this correct?
     TranspositionTableEntry *tte = tt->get_entry(pos->current_state->position_key);
     int ttScore = tte == nullptr ? LOOKUP_FAILED : tte->get_score(alpha, beta, depth);
-    if(ttScore != LOOKUP_FAILED)
+    STATS(res->stats.tt_probes++);
+    STATS(res->stats.tt_hits += tte != nullptr);
+    //Not at the root, which has to find its best move in the search. In other PV nodes this may cut the PV short
+    if(ttScore != LOOKUP_FAILED && height > 0 && excluded_move == NO_MOVE)
     {
+        STATS(res->stats.tt_cutoffs += ttScore >= beta);
         if(ttScore >= beta)
             return beta;
         if(ttScore > alpha)
             alpha = ttScore;
     }
 
+    //The subtrees below may overwrite the entry, keep what the singular extension needs
+    Move tt_move = tte != nullptr ? tte->pv_move : NO_MOVE;
+    int tt_score = tte != nullptr ? tte->score : 0;
+    Depth tt_depth = tte != nullptr ? tte->depth : 0;
+    bool tt_lower_bound = tte != nullptr && tte->type != UpperBound;
+
+    //Tablebase probe. Only right after a capture or a pawn move, so that the 50 moves rule cannot change the result
+    if(syzygy::max_pieces
+        && excluded_move == NO_MOVE
+        && !res->root_in_tb
+        && pos->current_state->ply != res->start_ply
+        && pos->current_state->fifty_moves == 0
+        && !pos->current_state->casteling_rights
+        && popcount(pos->color_bitboard[white] | pos->color_bitboard[black]) <= syzygy::max_pieces)
+    {
+        syzygy::ProbeState result;
+        syzygy::WDLScore wdl = syzygy::probe_wdl(pos, &result);
+        if(result != syzygy::PROBE_FAIL)
+        {
+            res->tb_hits++;
+
+            //Cursed wins and blessed losses are draws, but slightly better (worse) than a real draw
+            if(wdl == syzygy::WDL_WIN)
+            {
+                int score = TB_WIN - pos->current_state->ply;
+                if(score >= beta)
+                {
+                    tt->store(pos->current_state->position_key, LowerBound, score, NO_MOVE, depth, res->start_ply);
+                    return beta;
+                }
+                //The score is at least the tablebase win
+                if(score > alpha)
+                    alpha = score;
+            }
+            else if(wdl == syzygy::WDL_LOSS)
+            {
+                int score = -TB_WIN + pos->current_state->ply;
+                if(score <= alpha)
+                {
+                    tt->store(pos->current_state->position_key, UpperBound, score, NO_MOVE, depth, res->start_ply);
+                    return alpha;
+                }
+                //The score is at most the tablebase loss
+                if(score < beta)
+                    beta = score;
+            }
+            else
+            {
+                int score = DRAW + 2 * wdl;
+                tt->store(pos->current_state->position_key, Exact, score, NO_MOVE, depth, res->start_ply);
+                return score <= alpha ? alpha : score >= beta ? beta : score;
+            }
+        }
+    }
+
+    //The position is improving if our static evaluation is better than two plies ago
+    int static_eval = pos->current_state->in_check ? NO_EVAL : evaluate(pos);
+    res->static_evals[pos->current_state->ply] = static_eval;
+    bool improving = static_eval != NO_EVAL
+        && height >= 2
+        && static_eval > res->static_evals[pos->current_state->ply - 2];
+
+    //Reverse futility pruning: the static evaluation is so far above beta that a scout search will fail high
+    if(pruning_options.reverse_futility
+        && alpha + 1 == beta
+        && excluded_move == NO_MOVE
+        && static_eval != NO_EVAL
+        && depth <= REVERSE_FUTILITY_MAX_DEPTH
+        && abs(beta) < MAX_EVAL
+        && static_eval - REVERSE_FUTILITY_MARGIN * (depth - improving) >= beta)
+    {
+        STATS(res->stats.reverse_futility_cutoffs++);
+        return beta;
+    }
+
+    //Razoring: far below alpha only captures can help, verify it with qsearch
+    if(pruning_options.razoring
+        && alpha + 1 == beta
+        && excluded_move == NO_MOVE
+        && static_eval != NO_EVAL
+        && depth <= RAZORING_MAX_DEPTH
+        && abs(alpha) < MAX_EVAL
+        && static_eval + RAZORING_MARGIN * depth < alpha)
+    {
+        STATS(res->stats.razoring_tries++);
+        int score = qsearch(alpha, beta, pos, res);
+        if(score <= alpha)
+        {
+            STATS(res->stats.razoring_cutoffs++);
+            return alpha;
+        }
+    }
+
     //Futility pruning
-    if(depth <= 2) //Futility prune at shallow depths
+    if(depth <= 2 && excluded_move == NO_MOVE) //Futility prune at shallow depths
     {
-        int current_score = evaluate(pos);
+        STATS(res->stats.futility_tries++);
+        int current_score = static_eval != NO_EVAL ? static_eval : evaluate(pos);
         if(current_score + (200 * depth) + 100 < alpha)
         {
             //Eval is bad enough that we can prune
+            STATS(res->stats.futility_prunes++);
             return qsearch(alpha, beta, pos, res);
         }
     }
@@ -192,26 +624,96 @@ int search(Depth depth, int alpha, int beta, Position *pos, SearchResult *res)
     if(!pos->current_state->in_check //We are not in check
         && depth > NULL_MOVE_DEPTH_REDUCTION + 1 //We are not too shallow, so we can actually reduce the depth
         && pos->current_state->move != 0 //Last move was not a nullmove
+        && excluded_move == NO_MOVE
     )
     {
+        STATS(res->stats.null_move_tries++);
         pos->do_null_move();
+        //The extension budget of the path continues unchanged below the null move
+        res->extensions[pos->current_state->ply] = res->extensions[pos->current_state->ply - 1];
         //Do ZW-search after null move, we only want to know if result is above beta
         int score = -search<Cut>(depth - NULL_MOVE_DEPTH_REDUCTION - 1, -beta, -beta+1, pos, res);
         pos->undo_null_move();
 
         if(score >= beta)
         {
+            STATS(res->stats.null_move_cutoffs++);
             tt->store(pos->current_state->position_key, LowerBound, beta, NO_MOVE, depth, res->start_ply);
             return beta;
         }
     }
 
+    //ProbCut: if a capture beats beta by a margin at reduced depth, the full depth search would most likely cut too
+    if(pruning_options.probcut
+        && alpha + 1 == beta
+        && excluded_move == NO_MOVE
+        && !pos->current_state->in_check
+        && depth >= PROBCUT_MIN_DEPTH
+        && abs(beta) < MAX_EVAL)
+    {
+        int probcut_beta = beta + PROBCUT_MARGIN;
+        MovePicker captures(pos, tte, NO_MOVE, NO_MOVE, NO_MOVE, res, true);
+        Move move;
+        while((move = captures.next_move()) != NO_MOVE)
+        {
+            if(!captured_piece(move))
+                continue;
+
+            STATS(res->stats.probcut_tries++);
+            pos->do_move(move);
+            res->extensions[pos->current_state->ply] = res->extensions[pos->current_state->ply - 1];
+            //Look at the capture with qsearch first, only search it if that already beats the raised beta
+            int score = -qsearch(-probcut_beta, -probcut_beta + 1, pos, res);
+            if(score >= probcut_beta)
+                score = -search<All>(depth - PROBCUT_REDUCTION, -probcut_beta, -probcut_beta + 1, pos, res);
+            pos->undo_move();
+
+            if(score >= probcut_beta)
+            {
+                STATS(res->stats.probcut_cutoffs++);
+                tt->store(pos->current_state->position_key, LowerBound, beta, move, depth - PROBCUT_REDUCTION + 1, res->start_ply);
+                return beta;
+            }
+        }
+    }
+
+    //Without a hash move the move ordering is weak, which PV and Cut nodes pay for the most
+    if(    T != All
+        && height > 0
+        && depth >= IID_MIN_DEPTH
+        && tt_move == NO_MOVE
+        && excluded_move == NO_MOVE)
+    {
+        if(pruning_options.hash_move_search == HASH_MOVE_IID)
+        {
+            //A shallower search stores its best move, the move picker finds it in the TT_MOVE stage
+            search<T>(depth - IID_REDUCTION, alpha, beta, pos, res);
+            if(height < MAX_PV_LENGTH)
+                res->pv_table_length[height] = 0;
+
+            tte = tt->get_entry(pos->current_state->position_key);
+            if(tte != nullptr)
+            {
+                tt_move = tte->pv_move;
+                tt_score = tte->score;
+                tt_depth = tte->depth;
+                tt_lower_bound = tte->type != UpperBound;
+            }
+        }
+        else if(pruning_options.hash_move_search == HASH_MOVE_IIR)
+        {
+            //The next iteration finds this node with a hash move
+            depth--;
+        }
+    }
+
     bool pv_search = true;
-    MovePicker mp(pos, tte, res->killers[0][pos->current_state->ply], res->killers[1][pos->current_state->ply], res, false);
+    MovePicker mp(pos, tte, res->killers[0][pos->current_state->ply], res->killers[1][pos->current_state->ply], countermove(res, pos), res, false);
 
     //Multicut
-    if (depth >= 5 && T == Cut) 
+    if (depth >= 5 && T == Cut && excluded_move == NO_MOVE) 
     {
+        STATS(res->stats.multicut_tries++);
         int c = 0;
         Move move;
         while(mp.legal_moves() < 6 && (move = mp.next_move()) != NO_MOVE)
@@ -221,6 +723,7 @@ int search(Depth depth, int alpha, int beta, Position *pos, SearchResult *res)
             {
                 if (++c == 3)
                 {
+                    STATS(res->stats.multicut_cutoffs++);
                     return beta; // mc-prune
                 }
             }
@@ -228,62 +731,142 @@ int search(Depth depth, int alpha, int beta, Position *pos, SearchResult *res)
         mp.reset();
     }
 
+    //The root searches its own move list, sorted by the last iteration
+    bool root = height == 0;
+
+    //Singular extension: if all other moves fail low against a bound below the score of the TT move,
+    //the TT move is the only good move and is extended
+    bool tt_move_singular = false;
+    if(    !root
+        && depth >= SINGULAR_MIN_DEPTH
+        && excluded_move == NO_MOVE
+        && tt_move != NO_MOVE
+        && tt_lower_bound
+        && tt_depth >= depth - SINGULAR_TT_DEPTH_MARGIN
+        && abs(tt_score) < MAX_EVAL
+        && pos->is_legal(tt_move)
+        && pos->is_pseudo_legal(tt_move))
+    {
+        int singular_beta = tt_score - SINGULAR_MARGIN * depth;
+        res->excluded_moves[pos->current_state->ply] = tt_move;
+        int score = search<All>((depth - 1) / 2, singular_beta - 1, singular_beta, pos, res);
+        res->excluded_moves[pos->current_state->ply] = NO_MOVE;
+
+        if(score < singular_beta)
+            tt_move_singular = true;
+        //Another move beats beta as well, cut like multicut
+        else if(singular_beta >= beta && alpha + 1 == beta)
+            return beta;
+    }
+    int move_count = 0;
+    long int nodes_before = 0;
+
+    //The quiet moves which did not cause a cutoff, their history is lowered if another quiet move does
+    Move quiets_searched[64];
+    int num_quiets_searched = 0;
+
     Move move, best_move = NO_MOVE;
-    while((move = mp.next_move()) != NO_MOVE)
+    while((move = root ? (move_count < res->num_root_moves ? res->root_moves[move_count].move : NO_MOVE)
+                       : mp.next_move()) != NO_MOVE)
     {
-        if(res->start_ply == pos->current_state->ply)
+        if(move == excluded_move)
+            continue;
+
+        move_count++;
+
+        bool quiet = is_quiet(move);
+        int history = quiet ? quiet_move_score(res, pos, move) : 0;
+
+        //Move count pruning: at shallow depth the late quiet moves of a scout search are unlikely to raise alpha
+        if(    quiet
+            && alpha + 1 == beta
+            && !root
+            && depth <= LMP_MAX_DEPTH
+            && !pos->current_state->in_check
+            && move_count > move_count_limit(depth, improving))
+        {
+            continue;
+        }
+
+        if(root)
         {
-            uci::send_move_info(mp.legal_moves(), move, res->search_depth);
+            uci::send_move_info(move_count, move, res->search_depth);
+            nodes_before = res->nodes;
         }
 
+        bool in_check = pos->current_state->in_check;
         pos->do_move(move);
         int score;
 
-        Depth reduction = 0;
-
-        if(    mp.legal_moves() > 4          //Reduce moves located at the end of the move ordering
-            && !pos->current_state->in_check //Do not reduce while in check
-            && !captured_piece(move)         //Do not reduce captures
-            && !is_promotion(move)           //Do not reduce promotions
-            && alpha + 1 == beta             //Do only reduce in Scout searches
-            && depth >= 4                    //Do not reduce at shallow depths
-        )
+        //Late move reduction of quiet moves, a reduced move which raises alpha is searched again
+        Depth lmr = 0;
+        if(quiet && depth >= 3 && move_count > 1)
         {
-            //TODO is this good?
-            if(mp.legal_moves() < 10) reduction++;
-            else reduction += depth / 3;
-        }
+            lmr = reductions[std::min((int) depth, LMR_TABLE_SIZE - 1)][std::min(move_count, LMR_TABLE_SIZE - 1)];
+
+            if(T == PV) lmr--;
+            if(in_check || pos->current_state->in_check) lmr--;
+            if(!improving) lmr++;
+            if(move == mp.killer(0) || move == mp.killer(1)) lmr--;
+            lmr -= history / (HISTORY_MAX / 2);
 
-        //extensions for interesting moves
-        Piece captured_piece = captured_piece(move);
-        if(captured_piece == WHITE_QUEEN || captured_piece == BLACK_QUEEN) reduction -= 2;
-        if(captured_piece == WHITE_ROOK  || captured_piece == BLACK_ROOK) reduction --;
+            lmr = std::max(0, std::min((int) lmr, depth - 2));
+        }
 
-        if(pos->current_state->in_check) reduction --;
+        //Extensions, at most one ply per move and only while the path has budget left
+        Depth extension = 0;
+        int path_extensions = res->extensions[pos->current_state->ply - 1];
+        if(path_extensions < extension_budget(res))
+        {
+            if(move == tt_move && tt_move_singular)
+                extension = 1;
+            else if(pos->current_state->in_check)
+                extension = 1;
+            else if(is_recapture(pos, move))
+                extension = 1;
+        }
+        res->extensions[pos->current_state->ply] = path_extensions + extension;
 
         if(pv_search || alpha + 1 == beta || depth <= 2)
         {
             //Do not scout in pv_search mode, in ZW-Search or at shallow depths
-            score = -search<(NodeType)-T>(depth - 1 - reduction, -beta, -alpha, pos, res);
+            score = -search<(NodeType)-T>(depth - 1 + extension - lmr, -beta, -alpha, pos, res);
+            STATS(res->stats.lmr_searches += lmr > 0);
+            if(lmr > 0 && score > alpha)
+            {
+                STATS(res->stats.lmr_researches++);
+                score = -search<(NodeType)-T>(depth - 1 + extension, -beta, -alpha, pos, res);
+            }
         }
         else
         {
             //Do a scout search if we already found a good move
-            score = -search<Cut>(depth - 4, -alpha-1, -alpha, pos, res);
+            score = -search<Cut>(depth - 1 + extension - std::max((int) lmr, 3), -alpha-1, -alpha, pos, res);
             if(score > alpha)
-                score = -search<(NodeType)-T>(depth - 1 - reduction, -beta, -alpha, pos, res);
+                score = -search<(NodeType)-T>(depth - 1 + extension, -beta, -alpha, pos, res);
         }
 
         pos->undo_move();
 
+        if(root)
+        {
+            RootMove *root_move = &res->root_moves[move_count - 1];
+            root_move->score = score > alpha ? score : -INFINITY;
+            root_move->nodes = res->nodes - nodes_before;
+        }
+
         if(score >= beta)
         {
             res->fh++;
-            if(mp.legal_moves() == 1)
+            if(move_count == 1)
                 res->fhf++;
-            res->CutoffHistory[from_square(move)][to_square(move)]++;
+            STATS(res->stats.cutoffs[T + 1]++);
+            STATS(res->stats.first_move_cutoffs[T + 1] += move_count == 1);
             add_killer(pos, res, move);
-            tt->store(pos->current_state->position_key, LowerBound, beta, move, depth, res->start_ply);
+            if(is_quiet(move))
+                update_quiet_cutoff(res, pos, move, depth, quiets_searched, num_quiets_searched);
+            if(excluded_move == NO_MOVE)
+                tt->store(pos->current_state->position_key, LowerBound, beta, move, depth, res->start_ply);
             return beta;
         }
         else if(score > alpha)
@@ -291,11 +874,20 @@ int search(Depth depth, int alpha, int beta, Position *pos, SearchResult *res)
             alpha = score;
             pv_search = false;
             best_move = move;
+            if(T == PV)
+                update_pv(res, height, move);
         }
+
+        if(is_quiet(move) && num_quiets_searched < 64)
+            quiets_searched[num_quiets_searched++] = move;
     }
 
-    if(!mp.legal_moves())
+    if(!move_count)
     {
+        //The excluded move is the only legal move, so it is singular
+        if(excluded_move != NO_MOVE)
+            return alpha;
+
         //Checkmate if check, otherwise stalemate
         if(pos->current_state->in_check)
         {
@@ -307,6 +899,9 @@ int search(Depth depth, int alpha, int beta, Position *pos, SearchResult *res)
         }
     }
 
+    if(excluded_move != NO_MOVE)
+        return alpha;
+
     //Tablebase storing
     tt->store(pos->current_state->position_key, 
               best_move == NO_MOVE ? UpperBound : Exact, 
@@ -321,16 +916,20 @@ int search(Depth depth, int alpha, int beta, Position *pos, SearchResult *res)
 int qsearch(int alpha, int beta, Position *pos, SearchResult *res)
 {
     res->nodes++;
+    STATS(res->stats.qnodes++);
 
-    if(res->aborted)
+    if(should_stop(res))
         return DRAW;
     
     //We need no 50 moves check, because every move in qsearch is a capture or a pawn move
 
     TranspositionTableEntry *tte = tt->get_entry(pos->current_state->position_key);
     int ttScore = tte == nullptr ? LOOKUP_FAILED : tte->get_score(alpha, beta, -1);
+    STATS(res->stats.tt_probes++);
+    STATS(res->stats.tt_hits += tte != nullptr);
     if(ttScore != LOOKUP_FAILED)
     {
+        STATS(res->stats.tt_cutoffs += ttScore >= beta);
         if(ttScore >= beta)
             return beta;
         if(ttScore > alpha)
@@ -351,7 +950,7 @@ int qsearch(int alpha, int beta, Position *pos, SearchResult *res)
         //So we can safely return alpha. TODO: Not in endgames
         return alpha;
     
-    MovePicker mp(pos, tte, res->killers[0][pos->current_state->ply], res->killers[1][pos->current_state->ply], res, !pos->current_state->in_check);
+    MovePicker mp(pos, tte, res->killers[0][pos->current_state->ply], res->killers[1][pos->current_state->ply], NO_MOVE, res, !pos->current_state->in_check);
 
     int num_searched_moves = 0;
 
@@ -373,8 +972,6 @@ int qsearch(int alpha, int beta, Position *pos, SearchResult *res)
             res->fh++;
             if(num_searched_moves == 1)
                 res->fhf++;
-            res->CutoffHistory[from_square(move)][to_square(move)]++;
-            add_killer(pos, res, move);
             tt->store(pos->current_state->position_key, LowerBound, beta, move, -1, res->start_ply);
             return beta;
         }
@@ -1,7 +1,11 @@
 #ifndef SEARCH_H
 #define SEARCH_H
 
+#include <atomic>
+#include <chrono>
+
 #include "position.h"
+#include "stats.h"
 
 const int INFINITY = 30000;
 const int CHECKMATE = 29000;
@@ -10,6 +14,80 @@ const int DRAW = 0;
 const int MAX_PLY = 1024;
 const int MAX_PV_LENGTH = 32;
 
+//Deepest iteration of the search, used if the GUI sends no depth limit
+const Depth MAX_DEPTH = 64;
+
+//Tablebase wins are scored below the checkmate scores
+const int TB_WIN = CHECKMATE - MAX_PLY;
+
+//Marks a missing static evaluation, not a valid score
+const int NO_EVAL = -INFINITY - 1;
+
+//Late move reductions are looked up by [depth][move number], both capped at LMR_TABLE_SIZE - 1
+const int LMR_TABLE_SIZE = 64;
+
+//Move count pruning skips the late quiet moves up to this depth
+const int LMP_MAX_DEPTH = 3;
+
+//Reverse futility pruning: cut if the static evaluation beats beta by a margin per ply
+const int REVERSE_FUTILITY_MAX_DEPTH = 6;
+const int REVERSE_FUTILITY_MARGIN = 80;
+
+//Razoring: drop into qsearch if the static evaluation is far below alpha
+const int RAZORING_MAX_DEPTH = 3;
+const int RAZORING_MARGIN = 250;
+
+//ProbCut: a capture which beats beta by this margin at reduced depth probably beats beta at full depth
+const int PROBCUT_MIN_DEPTH = 5;
+const int PROBCUT_MARGIN = 150;
+const int PROBCUT_REDUCTION = 4;
+
+//Singular extension: the TT move is tested from this depth if its entry is at most SINGULAR_TT_DEPTH_MARGIN
+//plies shallower. The other moves are searched against the TT score minus SINGULAR_MARGIN per ply
+const int SINGULAR_MIN_DEPTH = 6;
+const int SINGULAR_TT_DEPTH_MARGIN = 3;
+const int SINGULAR_MARGIN = 2;
+
+//Extension plies every path may use, even in the first iterations
+const int MIN_EXTENSION_BUDGET = 2;
+
+//Scores beyond this bound are mates or tablebase results, the pruning stages keep away from them
+const int MAX_EVAL = TB_WIN - MAX_PLY;
+
+//What PV and Cut nodes do without a hash move: nothing, a shallower search to find one (internal iterative
+//deepening) or searching one ply less (internal iterative reduction)
+enum HashMoveSearch
+{
+    HASH_MOVE_NONE, HASH_MOVE_IID, HASH_MOVE_IIR
+};
+
+//Internal iterative deepening searches IID_REDUCTION plies less, both start at IID_MIN_DEPTH
+const int IID_MIN_DEPTH = 5;
+const int IID_REDUCTION = 2;
+
+//The forward pruning stages can be switched off (setoption) to measure what they are worth
+struct PruningOptions
+{
+    bool reverse_futility;
+    bool razoring;
+    bool probcut;
+    HashMoveSearch hash_move_search;
+};
+
+extern PruningOptions pruning_options;
+
+//Bound of the history values. The ordering scores of quiet moves stay far below the captures
+const int HISTORY_MAX = 16384;
+
+struct RootMove
+{
+    Move move;
+    //Score of the last search of the move, -INFINITY if it did not raise alpha
+    int score;
+    //Size of the subtree of the move in the last search
+    long int nodes;
+};
+
 struct SearchResult
 {
     long int fh;
@@ -18,16 +96,130 @@ struct SearchResult
     int score;
     Depth search_depth;
     int start_ply;
-    int CutoffHistory[64][64];
+    //History of the quiet moves, [color][from][to]
+    int history[2][64][64];
+    //History of the quiet moves after the move one or two plies before. Indexed by the moved piece and
+    //the to square of that move, then of the quiet move
+    int continuation_history[13][64][13][64];
+    //The quiet move which refuted a move, indexed by its moved piece and to square
+    Move countermoves[13][64];
     Move killers[2][MAX_PLY];
+    //Static evaluation of the nodes on the current path by game ply, NO_EVAL when in check
+    int static_evals[MAX_PLY];
+    //Extension plies of the current path up to the node at that game ply
+    int extensions[MAX_PLY];
+    //The move skipped by the singular extension search of the node at that game ply
+    Move excluded_moves[MAX_PLY];
+    //The principal variation of the last finished iteration
     Move pv[MAX_PV_LENGTH];
     int pv_length;
-    bool aborted;
+    //Triangular PV table, [height] holds the PV found below the node at that distance from the root
+    Move pv_table[MAX_PV_LENGTH][MAX_PV_LENGTH];
+    int pv_table_length[MAX_PV_LENGTH];
+    //Nodes of the finished iterations
+    long int total_nodes;
+    long int tb_hits;
+#ifdef SEARCH_STATS
+    SearchStats stats;
+#endif
+    //Set if the root position was found in the tablebases, the search is restricted to the root moves then
+    bool root_in_tb;
+    //The legal root moves, sorted by the results of the last search
+    RootMove root_moves[256];
+    int num_root_moves;
 };
 
 enum NodeType {PV = 0, Cut = 1, All=-1 };
 
-void do_search(Depth min_depth, Depth max_depth, Position *pos, int timeleft);
+//The search looks at the clock every CHECK_INTERVAL nodes, must be a power of 2
+const int CHECK_INTERVAL = 1024;
+
+struct SearchLimits
+{
+    Depth depth;
+    //0 means no limit
+    long int nodes;
+    //In milliseconds, -1 means no limit. No new iteration is started after the soft limit,
+    //the search is aborted at the hard limit
+    int soft_time;
+    int hard_time;
+
+    //The UCI go parameters, the time manager computes soft_time and hard_time from them (see timeman.h).
+    //Times in milliseconds, indexed by color, 0 if not sent
+    int time[2];
+    int increment[2];
+    int moves_to_go;
+    int move_time;
+    bool infinite;
+    //Search on the opponent's time, the clock only runs after ponderhit
+    bool ponder;
+};
+
+//Decides when the search stops. The stop flag and ponderhit may also be set by the UCI thread
+struct SearchController
+{
+    std::atomic<bool> stop;
+    //Set while pondering, the time limits do not apply then
+    std::atomic<bool> pondering;
+    std::atomic<bool> ponderhit_received;
+    SearchLimits limits;
+    std::chrono::steady_clock::time_point start_time;
+    //Scales the soft time limit, adjusted by the time manager after every iteration
+    float soft_time_factor;
+
+    //Has to be called before do_search
+    void start(SearchLimits *limits);
+
+    //The opponent played the expected move, the search continues with the normal time limits
+    void ponderhit();
+
+    //Blocks an infinite or pondering search which finished early until the GUI wants the best move
+    void wait_for_stop();
+
+    //Milliseconds since the start of the search
+    int elapsed();
+
+    //Called by the search every CHECK_INTERVAL nodes, sets the stop flag if a hard limit is reached
+    void poll(long int nodes);
+
+    bool soft_limit_reached();
+
+private:
+    //Switches from pondering to the normal search, called by the search thread only
+    void update_ponder();
+};
+
+extern SearchController search_controller;
+
+//Precomputes the reduction table, has to be called once at startup
+void init_search();
+
+//Searches with the limits of search_controller and sends the best move. The position is not changed
+void do_search(Depth min_depth, Position *pos);
+
+//Forgets the history tables and killers of the last game
+void new_game();
+
+//Replaces the transposition table by an empty one of at most the given size
+void set_hash_size(int megabytes);
+
+//Empties the transposition table
+void clear_hash();
+
+//Sets the transposition table and search data of the game aside, the following searches get new ones (e.g. bench)
+void suspend_game();
+
+//Frees the table and search data used since suspend_game and restores the ones of the game
+void resume_game();
+
+//Nodes of the finished iterations of the last search
+long int searched_nodes();
+
+//Ordering score of a quiet move from the history tables
+int quiet_move_score(SearchResult *res, Position *pos, Move move);
+
+//The refutation of the last move, NO_MOVE if there is none
+Move countermove(SearchResult *res, Position *pos);
 
 //Alpha-beta search
 template<NodeType T>
@@ -0,0 +1,45 @@
+#ifndef STATS_H
+#define STATS_H
+
+//Search statistics are only compiled with -DSEARCH_STATS (make stats), otherwise STATS(...) disappears
+#ifdef SEARCH_STATS
+#define STATS(statement) statement
+#else
+#define STATS(statement)
+#endif
+
+//The counters of one iteration (all aspiration searches of a depth), reported by uci::send_search_stats
+struct SearchStats
+{
+    //All nodes of the iteration, the qsearch nodes are included
+    long int nodes;
+    long int qnodes;
+
+    long int tt_probes;
+    long int tt_hits;
+    long int tt_cutoffs;
+
+    long int null_move_tries;
+    long int null_move_cutoffs;
+    long int futility_tries;
+    long int futility_prunes;
+    long int multicut_tries;
+    long int multicut_cutoffs;
+    long int reverse_futility_cutoffs;
+    long int razoring_tries;
+    long int razoring_cutoffs;
+    long int probcut_tries;
+    long int probcut_cutoffs;
+
+    //Reduced searches and the ones which raised alpha and were searched again
+    long int lmr_searches;
+    long int lmr_researches;
+
+    //Beta cutoffs of the move loop and the ones by the first move, indexed by node type + 1 (All, PV, Cut)
+    long int cutoffs[3];
+    long int first_move_cutoffs[3];
+
+    int aspiration_researches;
+};
+
+#endif //!STATS_H
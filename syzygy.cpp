@@ -0,0 +1,1363 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <limits.h>
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "syzygy.h"
+#include "bitboards.h"
+#include "movegen.h"
+
+//Probing code for the Syzygy tablebases, following the reference implementation of the format.
+//The tables store the positions with the stronger side as white. The pieces of a position are
+//split in groups (the leading group, the remaining pawns and one group per piece type) which are
+//encoded to an index, the value of the index is decompressed from Huffman coded blocks.
+
+namespace syzygy
+{
+    int max_pieces = 0;
+
+    enum TableType
+    {
+        WDL, DTZ
+    };
+
+    //Flags of a (sub) table, stored in the file
+    enum TableFlag
+    {
+        FLAG_STM = 1, FLAG_MAPPED = 2, FLAG_WIN_PLIES = 4, FLAG_LOSS_PLIES = 8, FLAG_WIDE = 16, FLAG_SINGLE_VALUE = 128
+    };
+
+    const char *PIECE_CHARS = " PNBRQK";
+
+    //Number of table slots, indexed by the material signature. There are 1511 tables up to 7 pieces with 2 keys each
+    const int TB_HASH_BITS = 13;
+    const int TB_HASH_SIZE = 1 << TB_HASH_BITS;
+
+    int map_pawns[64];
+    int map_b1h1h7[64];
+    int map_a1d1d4[64];
+    int map_kk[10][64];
+
+    //[k][n] ways to choose k elements from a set of n elements
+    int binomial[6][64];
+    //[Number of leading pawns][Square]
+    int lead_pawn_idx[6][64];
+    //[Number of leading pawns][File a-d]
+    int lead_pawns_size[6][4];
+
+    std::vector<std::string> paths;
+
+    //The file stores numbers in both byte orders, read them byte-wise so the host order does not matter
+    inline uint16_t read_le16(const uint8_t *p) { return p[0] | (p[1] << 8); }
+    inline uint32_t read_le32(const uint8_t *p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24); }
+    inline uint32_t read_be32(const uint8_t *p) { return ((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3]; }
+    inline uint64_t read_be64(const uint8_t *p) { return ((uint64_t)read_be32(p) << 32) | read_be32(p + 4); }
+
+    //Ranks minus files, negative below the a1-h8 diagonal
+    inline int off_a1h8(int s) { return s / 8 - s % 8; }
+
+    inline Piece flip_color(Piece piece)
+    {
+        return piece == NO_PIECE ? NO_PIECE : piece <= WHITE_KING ? (Piece)(piece + 6) : (Piece)(piece - 6);
+    }
+
+    //The files encode pieces with a color bit of 8
+    inline Piece tb_piece(int code)
+    {
+        return (code & 7) == 0 ? NO_PIECE : make_piece((code & 7), (code & 8 ? black : white));
+    }
+
+    //Every piece count fits into 4 bits, so the packed counts are a unique key
+    Key material_signature(const int material[13])
+    {
+        Key key = 0;
+        for(int i = WHITE_PAWN; i <= BLACK_QUEEN; i++)
+            key |= (Key) material[i] << (4 * i);
+        return key;
+    }
+
+    //Low level data to decompress a sub table
+    struct PairsData
+    {
+        uint8_t flags;
+        size_t block_size;
+        //There is a sparse index entry about every span values
+        size_t span;
+        int num_blocks;
+        int max_sym_len;
+        int min_sym_len;
+        //lowest_sym[l] is the symbol of length l with the lowest value
+        const uint8_t *lowest_sym;
+        //btree[sym] stores the left and right symbols that expand sym, 3 bytes each
+        const uint8_t *btree;
+        //Number of values (minus one) stored in each block
+        const uint8_t *block_length;
+        int block_length_size;
+        const uint8_t *sparse_index;
+        size_t sparse_index_size;
+        const uint8_t *data;
+        //base64[l - min_sym_len] is the lowest symbol of length l, padded to 64 bits
+        std::vector<uint64_t> base64;
+        //Number of values (minus one) represented by a symbol
+        std::vector<uint8_t> symlen;
+        //The order of the pieces defines the groups
+        Piece pieces[TB_PIECES];
+        uint64_t group_idx[TB_PIECES + 1];
+        int group_len[TB_PIECES + 1];
+        //Offsets of the DTZ value maps for WDL_WIN, WDL_LOSS, WDL_CURSED_WIN, WDL_BLESSED_LOSS
+        uint16_t map_idx[4];
+    };
+
+    inline int sym_left(const PairsData *d, int sym)
+    {
+        const uint8_t *lr = d->btree + 3 * sym;
+        return ((lr[1] & 0xF) << 8) | lr[0];
+    }
+
+    inline int sym_right(const PairsData *d, int sym)
+    {
+        const uint8_t *lr = d->btree + 3 * sym;
+        return (lr[2] << 4) | (lr[1] >> 4);
+    }
+
+    struct Table
+    {
+        TableType type;
+        //File name without extension, e.g. KRvK
+        char name[TB_PIECES + 2];
+
+        //Set once the file was mapped (or failed to map), the data is read-only after that
+        std::atomic<bool> ready;
+        uint8_t *base_address;
+        uint64_t mapping_size;
+#ifdef _WIN32
+        HANDLE mapping_handle;
+#endif
+        //DTZ value maps
+        const uint8_t *map;
+
+        //Material signature with the stronger side as white (key) and as black (key2)
+        Key key;
+        Key key2;
+        int piece_count;
+        bool has_pawns;
+        bool has_unique_pieces;
+        //[Leading color, other color]
+        int pawn_count[2];
+        //[Side to move][File a-d, or 0 without pawns]. DTZ tables only store one side to move
+        PairsData items[2][4];
+
+        PairsData *get(int stm, int file)
+        {
+            return &items[type == WDL ? stm : 0][has_pawns ? file : 0];
+        }
+    };
+
+    struct TableSlot
+    {
+        Key key;
+        Table *wdl;
+        Table *dtz;
+    };
+
+    TableSlot table_slots[TB_HASH_SIZE];
+    std::vector<Table *> tables;
+
+    Table *find_table(Key key, TableType type)
+    {
+        for(int index = (key * 0x9E3779B97F4A7C15ull) >> (64 - TB_HASH_BITS); table_slots[index].wdl != nullptr; index = (index + 1) & (TB_HASH_SIZE - 1))
+        {
+            if(table_slots[index].key == key)
+                return type == WDL ? table_slots[index].wdl : table_slots[index].dtz;
+        }
+        return nullptr;
+    }
+
+    void insert_table(Key key, Table *wdl, Table *dtz)
+    {
+        int index = (key * 0x9E3779B97F4A7C15ull) >> (64 - TB_HASH_BITS);
+        while(table_slots[index].wdl != nullptr && table_slots[index].key != key)
+            index = (index + 1) & (TB_HASH_SIZE - 1);
+
+        table_slots[index].key = key;
+        table_slots[index].wdl = wdl;
+        table_slots[index].dtz = dtz;
+    }
+
+    //Returns the full path of the file in the first directory that contains it, or an empty string
+    std::string find_file(const std::string &name)
+    {
+        for(const std::string &path : paths)
+        {
+            std::string file_name = path + "/" + name;
+            FILE *file = fopen(file_name.c_str(), "rb");
+            if(file != nullptr)
+            {
+                fclose(file);
+                return file_name;
+            }
+        }
+        return std::string();
+    }
+
+    void unmap(Table *table)
+    {
+        if(table->base_address == nullptr)
+            return;
+#ifdef _WIN32
+        UnmapViewOfFile(table->base_address);
+        CloseHandle(table->mapping_handle);
+#else
+        munmap(table->base_address, table->mapping_size);
+#endif
+        table->base_address = nullptr;
+    }
+
+    //Maps the file of the table and checks its magic number. Returns the data after the magic number or nullptr
+    uint8_t *map_file(Table *table)
+    {
+        std::string file_name = find_file(std::string(table->name) + (table->type == WDL ? ".rtbw" : ".rtbz"));
+        if(file_name.empty())
+            return nullptr;
+
+#ifdef _WIN32
+        HANDLE file = CreateFileA(file_name.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, nullptr);
+        if(file == INVALID_HANDLE_VALUE)
+            return nullptr;
+
+        LARGE_INTEGER size;
+        GetFileSizeEx(file, &size);
+        table->mapping_size = size.QuadPart;
+        table->mapping_handle = CreateFileMapping(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        CloseHandle(file);
+        if(table->mapping_handle == nullptr)
+            return nullptr;
+
+        table->base_address = (uint8_t *) MapViewOfFile(table->mapping_handle, FILE_MAP_READ, 0, 0, 0);
+        if(table->base_address == nullptr)
+        {
+            CloseHandle(table->mapping_handle);
+            return nullptr;
+        }
+#else
+        int fd = open(file_name.c_str(), O_RDONLY);
+        if(fd == -1)
+            return nullptr;
+
+        struct stat file_stat;
+        fstat(fd, &file_stat);
+        table->mapping_size = file_stat.st_size;
+        void *address = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if(address == MAP_FAILED)
+        {
+            printf("info string Could not map %s\n", file_name.c_str());
+            return nullptr;
+        }
+        madvise(address, file_stat.st_size, MADV_RANDOM);
+        table->base_address = (uint8_t *) address;
+#endif
+
+        const uint8_t MAGIC[2][4] = { { 0x71, 0xE8, 0x23, 0x5D }, { 0xD7, 0x66, 0x0C, 0xA5 } };
+        if(table->mapping_size % 64 != 16 || memcmp(table->base_address, MAGIC[table->type], 4))
+        {
+            printf("info string Corrupt tablebase file %s\n", file_name.c_str());
+            unmap(table);
+            return nullptr;
+        }
+
+        return table->base_address + 4;
+    }
+
+    //Returns the value at index idx of the sub table
+    int decompress_pairs(PairsData *d, uint64_t idx)
+    {
+        //All positions store the same value
+        if(d->flags & FLAG_SINGLE_VALUE)
+            return d->min_sym_len;
+
+        //The sparse index entry k points to the block and offset of the value k * span + span / 2
+        uint32_t k = (uint32_t)(idx / d->span);
+        uint32_t block = read_le32(d->sparse_index + 6 * k);
+        int offset = read_le16(d->sparse_index + 6 * k + 4);
+
+        offset += (int)(idx % d->span) - (int)(d->span / 2);
+
+        //Every block stores block_length + 1 values, walk to the block containing idx
+        while(offset < 0)
+            offset += read_le16(d->block_length + 2 * (--block)) + 1;
+
+        while(offset > read_le16(d->block_length + 2 * block))
+            offset -= read_le16(d->block_length + 2 * (block++)) + 1;
+
+        const uint8_t *ptr = d->data + (uint64_t)block * d->block_size;
+
+        //Decode the canonical Huffman symbols of the block until we reach the one containing our value
+        uint64_t buf64 = read_be64(ptr);
+        ptr += 8;
+        int buf64_size = 64;
+        int sym;
+
+        while(true)
+        {
+            int len = 0;
+            while(buf64 < d->base64[len])
+                len++;
+
+            sym = (int)((buf64 - d->base64[len]) >> (64 - len - d->min_sym_len));
+            sym += read_le16(d->lowest_sym + 2 * len);
+
+            if(offset < d->symlen[sym] + 1)
+                break;
+
+            offset -= d->symlen[sym] + 1;
+            len += d->min_sym_len;
+            buf64 <<= len;
+            buf64_size -= len;
+
+            //Refill the buffer
+            if(buf64_size <= 32)
+            {
+                buf64_size += 32;
+                buf64 |= (uint64_t) read_be32(ptr) << (64 - buf64_size);
+                ptr += 4;
+            }
+        }
+
+        //The symbol expands into a pair of symbols (recursive pairing), descend to the leaf with our value
+        while(d->symlen[sym])
+        {
+            int left = sym_left(d, sym);
+            if(offset < d->symlen[left] + 1)
+                sym = left;
+            else
+            {
+                offset -= d->symlen[left] + 1;
+                sym = sym_right(d, sym);
+            }
+        }
+
+        return sym_left(d, sym);
+    }
+
+    //DTZ tables are one-sided, they only store one side to move
+    bool check_dtz_stm(Table *table, int stm, int file)
+    {
+        if(table->type == WDL)
+            return true;
+
+        int flags = table->get(stm, file)->flags;
+        return (flags & FLAG_STM) == stm || (table->key == table->key2 && !table->has_pawns);
+    }
+
+    //Converts the stored value to a WDL score or the DTZ in plies
+    int map_score(Table *table, int file, int value, WDLScore wdl)
+    {
+        if(table->type == WDL)
+            return value - 2;
+
+        const int WDL_MAP[] = { 1, 3, 0, 2, 0 };
+
+        PairsData *d = table->get(0, file);
+        if(d->flags & FLAG_MAPPED)
+        {
+            if(d->flags & FLAG_WIDE)
+                value = read_le16(table->map + 2 * (d->map_idx[WDL_MAP[wdl + 2]] + value));
+            else
+                value = table->map[d->map_idx[WDL_MAP[wdl + 2]] + value];
+        }
+
+        //The table stores moves or plies
+        if((wdl == WDL_WIN && !(d->flags & FLAG_WIN_PLIES))
+            || (wdl == WDL_LOSS && !(d->flags & FLAG_LOSS_PLIES))
+            || wdl == WDL_CURSED_WIN
+            || wdl == WDL_BLESSED_LOSS)
+            value *= 2;
+
+        return value + 1;
+    }
+
+    //Computes the index of the position in the table and looks up its value
+    int do_probe_table(Position *pos, Table *table, WDLScore wdl, ProbeState *result)
+    {
+        Square squares[TB_PIECES];
+        Piece pieces[TB_PIECES];
+        uint64_t idx;
+        int size = 0, lead_pawns_count = 0;
+        Bitboard b, lead_pawns = 0;
+        int tb_file = 0;
+
+        //Symmetric tables only store white to move, otherwise the table stores the stronger side as white
+        Key key = material_signature(pos->material);
+        bool symmetric_black_to_move = table->key == table->key2 && pos->color_to_move == black;
+        bool black_stronger = key != table->key;
+        bool flip = symmetric_black_to_move || black_stronger;
+
+        int flip_squares = flip ? 56 : 0;
+        int stm = flip ^ pos->color_to_move;
+
+        auto pawns_less = [](Square a, Square b) { return map_pawns[a] < map_pawns[b]; };
+
+        //Tables with pawns are split by the file of the leading pawn, the one nearest to the edge and with the lowest rank
+        if(table->has_pawns)
+        {
+            Piece lead_piece = table->get(0, 0)->pieces[0];
+            if(flip)
+                lead_piece = flip_color(lead_piece);
+
+            ASSERT(piece_type_of(lead_piece) == PAWN);
+
+            lead_pawns = b = pos->piece_bitboard[lead_piece];
+            do
+                squares[size++] = (Square)(pop_lsb(&b) ^ flip_squares);
+            while(b);
+
+            lead_pawns_count = size;
+
+            std::swap(squares[0], *std::max_element(squares, squares + lead_pawns_count, pawns_less));
+
+            int file = squares[0] % 8;
+            tb_file = file < 4 ? file : 7 - file;
+        }
+
+        if(!check_dtz_stm(table, stm, tb_file))
+        {
+            *result = PROBE_CHANGE_STM;
+            return 0;
+        }
+
+        b = (pos->color_bitboard[white] | pos->color_bitboard[black]) ^ lead_pawns;
+        do
+        {
+            Square s = pop_lsb(&b);
+            squares[size] = (Square)(s ^ flip_squares);
+            pieces[size++] = flip ? flip_color(pos->board[s]) : pos->board[s];
+        } while(b);
+
+        PairsData *d = table->get(stm, tb_file);
+
+        //Order the pieces like the table does
+        for(int i = lead_pawns_count; i < size - 1; i++)
+        {
+            for(int j = i + 1; j < size; j++)
+            {
+                if(d->pieces[i] == pieces[j])
+                {
+                    std::swap(pieces[i], pieces[j]);
+                    std::swap(squares[i], squares[j]);
+                    break;
+                }
+            }
+        }
+
+        //Mirror the board so that the leading piece is on the files a-d
+        if(squares[0] % 8 > 3)
+            for(int i = 0; i < size; i++)
+                squares[i] = (Square)(squares[i] ^ 7);
+
+        if(table->has_pawns)
+        {
+            idx = lead_pawn_idx[lead_pawns_count][squares[0]];
+
+            std::stable_sort(squares + 1, squares + lead_pawns_count, pawns_less);
+
+            for(int i = 1; i < lead_pawns_count; i++)
+                idx += binomial[i][map_pawns[squares[i]]];
+        }
+        else
+        {
+            //Without pawns, mirror the board so that the leading piece is on the ranks 1-4
+            if(squares[0] / 8 > 3)
+                for(int i = 0; i < size; i++)
+                    squares[i] = (Square)(squares[i] ^ 56);
+
+            //The first piece of the leading group which is not on the a1-h8 diagonal has to be below it
+            for(int i = 0; i < d->group_len[0]; i++)
+            {
+                if(!off_a1h8(squares[i]))
+                    continue;
+
+                if(off_a1h8(squares[i]) > 0)
+                    for(int j = i; j < size; j++)
+                        squares[j] = (Square)(((squares[j] >> 3) | (squares[j] << 3)) & 63);
+                break;
+            }
+
+            //With at least 3 unique pieces (kings included), they are encoded together, otherwise only the kings
+            if(table->has_unique_pieces)
+            {
+                int adjust1 = squares[1] > squares[0];
+                int adjust2 = (squares[2] > squares[0]) + (squares[2] > squares[1]);
+
+                if(off_a1h8(squares[0]))
+                    idx = (map_a1d1d4[squares[0]] * 63 + (squares[1] - adjust1)) * 62 + squares[2] - adjust2;
+                else if(off_a1h8(squares[1]))
+                    idx = (6 * 63 + (squares[0] / 8) * 28 + map_b1h1h7[squares[1]]) * 62 + squares[2] - adjust2;
+                else if(off_a1h8(squares[2]))
+                    idx = 6 * 63 * 62 + 4 * 28 * 62
+                        + (squares[0] / 8) * 7 * 28
+                        + (squares[1] / 8 - adjust1) * 28
+                        + map_b1h1h7[squares[2]];
+                else
+                    idx = 6 * 63 * 62 + 4 * 28 * 62 + 4 * 7 * 28
+                        + (squares[0] / 8) * 7 * 6
+                        + (squares[1] / 8 - adjust1) * 6
+                        + (squares[2] / 8 - adjust2);
+            }
+            else
+                idx = map_kk[map_a1d1d4[squares[0]]][squares[1]];
+        }
+
+        //Encode the remaining groups, each one by the sorted squares left free by the previous groups
+        idx *= d->group_idx[0];
+        Square *group_squares = squares + d->group_len[0];
+        bool remaining_pawns = table->has_pawns && table->pawn_count[1];
+
+        for(int next = 1; d->group_len[next]; next++)
+        {
+            std::stable_sort(group_squares, group_squares + d->group_len[next]);
+            uint64_t n = 0;
+
+            for(int i = 0; i < d->group_len[next]; i++)
+            {
+                int adjust = 0;
+                for(Square *s = squares; s < group_squares; s++)
+                    adjust += group_squares[i] > *s;
+                n += binomial[i + 1][group_squares[i] - adjust - 8 * remaining_pawns];
+            }
+
+            remaining_pawns = false;
+            idx += n * d->group_idx[next];
+            group_squares += d->group_len[next];
+        }
+
+        return map_score(table, tb_file, decompress_pairs(d, idx), wdl);
+    }
+
+    //Splits the pieces into groups and computes the index factor of each group. The order of the groups
+    //in the index is stored in the file
+    void set_groups(Table *table, PairsData *d, int order[], int file)
+    {
+        int n = 0, first_len = table->has_pawns ? 0 : table->has_unique_pieces ? 3 : 2;
+        d->group_len[n] = 1;
+
+        for(int i = 1; i < table->piece_count; i++)
+        {
+            if(--first_len > 0 || d->pieces[i] == d->pieces[i - 1])
+                d->group_len[n]++;
+            else
+                d->group_len[++n] = 1;
+        }
+
+        d->group_len[++n] = 0;
+
+        bool pawns_on_both_sides = table->has_pawns && table->pawn_count[1];
+        int next = pawns_on_both_sides ? 2 : 1;
+        int free_squares = 64 - d->group_len[0] - (pawns_on_both_sides ? d->group_len[1] : 0);
+        uint64_t idx = 1;
+
+        for(int k = 0; next < n || k == order[0] || k == order[1]; k++)
+        {
+            if(k == order[0])
+            {
+                //Leading pawns or pieces
+                d->group_idx[0] = idx;
+                idx *= table->has_pawns ? lead_pawns_size[d->group_len[0]][file] : table->has_unique_pieces ? 31332 : 462;
+            }
+            else if(k == order[1])
+            {
+                //Remaining pawns
+                d->group_idx[1] = idx;
+                idx *= binomial[d->group_len[1]][48 - d->group_len[0]];
+            }
+            else
+            {
+                //Remaining pieces
+                d->group_idx[next] = idx;
+                idx *= binomial[d->group_len[next]][free_squares];
+                free_squares -= d->group_len[next++];
+            }
+        }
+
+        d->group_idx[n] = idx;
+    }
+
+    //Returns the number of values (minus one) a symbol expands to
+    uint8_t set_symlen(PairsData *d, int sym, std::vector<bool> &visited)
+    {
+        visited[sym] = true;
+        int right = sym_right(d, sym);
+
+        if(right == 0xFFF)
+            return 0;
+
+        int left = sym_left(d, sym);
+
+        if(!visited[left])
+            d->symlen[left] = set_symlen(d, left, visited);
+
+        if(!visited[right])
+            d->symlen[right] = set_symlen(d, right, visited);
+
+        return d->symlen[left] + d->symlen[right] + 1;
+    }
+
+    const uint8_t *set_sizes(PairsData *d, const uint8_t *data)
+    {
+        d->flags = *data++;
+
+        if(d->flags & FLAG_SINGLE_VALUE)
+        {
+            d->num_blocks = d->block_length_size = 0;
+            d->span = d->sparse_index_size = 0;
+            //The single value is stored here
+            d->min_sym_len = *data++;
+            return data;
+        }
+
+        //The last group index is the size of the table
+        int num_groups = 0;
+        while(d->group_len[num_groups])
+            num_groups++;
+        uint64_t table_size = d->group_idx[num_groups];
+
+        d->block_size = 1ull << *data++;
+        d->span = 1ull << *data++;
+        d->sparse_index_size = (size_t)((table_size + d->span - 1) / d->span);
+        int padding = *data++;
+        d->num_blocks = read_le32(data);
+        data += 4;
+        //Padded so that the sparse index does not point out of range
+        d->block_length_size = d->num_blocks + padding;
+        d->max_sym_len = *data++;
+        d->min_sym_len = *data++;
+        d->lowest_sym = data;
+        d->base64.resize(d->max_sym_len - d->min_sym_len + 1);
+
+        //Longer symbols have lower values in the canonical code, compute the lowest symbol of every length padded to 64 bits
+        for(int i = (int) d->base64.size() - 2; i >= 0; i--)
+        {
+            d->base64[i] = (d->base64[i + 1] + read_le16(d->lowest_sym + 2 * i) - read_le16(d->lowest_sym + 2 * (i + 1))) / 2;
+            ASSERT(d->base64[i] * 2 >= d->base64[i + 1]);
+        }
+
+        for(size_t i = 0; i < d->base64.size(); i++)
+            d->base64[i] <<= 64 - i - d->min_sym_len;
+
+        data += d->base64.size() * 2;
+        d->symlen.resize(read_le16(data));
+        data += 2;
+        d->btree = data;
+
+        std::vector<bool> visited(d->symlen.size());
+        for(size_t sym = 0; sym < d->symlen.size(); sym++)
+            if(!visited[sym])
+                d->symlen[sym] = set_symlen(d, sym, visited);
+
+        return data + d->symlen.size() * 3 + (d->symlen.size() & 1);
+    }
+
+    const uint8_t *set_dtz_map(Table *table, const uint8_t *data, int max_file)
+    {
+        table->map = data;
+
+        for(int file = 0; file <= max_file; file++)
+        {
+            PairsData *d = table->get(0, file);
+            if(!(d->flags & FLAG_MAPPED))
+                continue;
+
+            if(d->flags & FLAG_WIDE)
+            {
+                data += (uintptr_t)data & 1;
+                for(int i = 0; i < 4; i++)
+                {
+                    d->map_idx[i] = (uint16_t)((data - table->map) / 2 + 1);
+                    data += 2 * read_le16(data) + 2;
+                }
+            }
+            else
+            {
+                for(int i = 0; i < 4; i++)
+                {
+                    d->map_idx[i] = (uint16_t)(data - table->map + 1);
+                    data += *data + 1;
+                }
+            }
+        }
+
+        return data + ((uintptr_t)data & 1);
+    }
+
+    //Reads the layout of the sub tables from the mapped file
+    void set(Table *table, const uint8_t *data)
+    {
+        const int SPLIT = 1, HAS_PAWNS = 2;
+
+        ASSERT(table->has_pawns == !!(*data & HAS_PAWNS));
+        ASSERT((table->key != table->key2) == !!(*data & SPLIT));
+        (void) SPLIT;
+        (void) HAS_PAWNS;
+
+        data++;
+
+        int sides = table->type == WDL && table->key != table->key2 ? 2 : 1;
+        int max_file = table->has_pawns ? 3 : 0;
+        bool pawns_on_both_sides = table->has_pawns && table->pawn_count[1];
+
+        for(int file = 0; file <= max_file; file++)
+        {
+            for(int i = 0; i < sides; i++)
+                *table->get(i, file) = PairsData();
+
+            int order[2][2] = { { *data & 0xF, pawns_on_both_sides ? *(data + 1) & 0xF : 0xF },
+                                { *data >> 4,  pawns_on_both_sides ? *(data + 1) >> 4  : 0xF } };
+            data += 1 + pawns_on_both_sides;
+
+            for(int k = 0; k < table->piece_count; k++, data++)
+                for(int i = 0; i < sides; i++)
+                    table->get(i, file)->pieces[k] = tb_piece(i ? *data >> 4 : *data & 0xF);
+
+            for(int i = 0; i < sides; i++)
+                set_groups(table, table->get(i, file), order[i], file);
+        }
+
+        data += (uintptr_t)data & 1;
+
+        for(int file = 0; file <= max_file; file++)
+            for(int i = 0; i < sides; i++)
+                data = set_sizes(table->get(i, file), data);
+
+        if(table->type == DTZ)
+            data = set_dtz_map(table, data, max_file);
+
+        for(int file = 0; file <= max_file; file++)
+        {
+            for(int i = 0; i < sides; i++)
+            {
+                PairsData *d = table->get(i, file);
+                d->sparse_index = data;
+                data += d->sparse_index_size * 6;
+            }
+        }
+
+        for(int file = 0; file <= max_file; file++)
+        {
+            for(int i = 0; i < sides; i++)
+            {
+                PairsData *d = table->get(i, file);
+                d->block_length = data;
+                data += d->block_length_size * 2;
+            }
+        }
+
+        for(int file = 0; file <= max_file; file++)
+        {
+            for(int i = 0; i < sides; i++)
+            {
+                //The blocks are aligned to 64 bytes
+                data = (const uint8_t *)(((uintptr_t)data + 0x3F) & ~(uintptr_t)0x3F);
+                PairsData *d = table->get(i, file);
+                d->data = data;
+                data += (uint64_t) d->num_blocks * d->block_size;
+            }
+        }
+    }
+
+    //Maps the file at the first probe. Safe to call from several threads
+    bool is_mapped(Table *table)
+    {
+        static std::mutex mutex;
+
+        if(table->ready.load(std::memory_order_acquire))
+            return table->base_address != nullptr;
+
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if(table->ready.load(std::memory_order_relaxed))
+            return table->base_address != nullptr;
+
+        uint8_t *data = map_file(table);
+        if(data != nullptr)
+            set(table, data);
+
+        table->ready.store(true, std::memory_order_release);
+        return table->base_address != nullptr;
+    }
+
+    int probe_table(Position *pos, TableType type, ProbeState *result, WDLScore wdl = WDL_DRAW)
+    {
+        //King against king
+        if(popcount(pos->color_bitboard[white] | pos->color_bitboard[black]) == 2)
+            return WDL_DRAW;
+
+        Table *table = find_table(material_signature(pos->material), type);
+        if(table == nullptr || !is_mapped(table))
+        {
+            *result = PROBE_FAIL;
+            return 0;
+        }
+
+        return do_probe_table(pos, table, wdl, result);
+    }
+
+    inline bool is_capture(Move move)
+    {
+        return captured_piece(move) != NO_PIECE || is_en_passent(move);
+    }
+
+    inline bool is_zeroing(Move move)
+    {
+        return is_capture(move) || piece_type_of(moved_piece(move)) == PAWN;
+    }
+
+    bool has_legal_move(Position *pos)
+    {
+        MoveList moves(pos, false);
+        for(int i = 0; i < moves.size; i++)
+            if(pos->is_legal(moves.moveList[i].move))
+                return true;
+        return false;
+    }
+
+    //The tables store "don't care" values for positions where a capture is the best move (and do not know
+    //about en passent), so the captures (and with check_zeroing_moves the pawn moves) are searched as well
+    WDLScore search(Position *pos, ProbeState *result, bool check_zeroing_moves)
+    {
+        WDLScore value, best_value = WDL_LOSS;
+        int num_moves = 0, num_searched_moves = 0;
+
+        MoveList moves(pos, false);
+        for(int i = 0; i < moves.size; i++)
+        {
+            Move move = moves.moveList[i].move;
+            if(!pos->is_legal(move))
+                continue;
+
+            num_moves++;
+            if(!is_capture(move) && (!check_zeroing_moves || piece_type_of(moved_piece(move)) != PAWN))
+                continue;
+
+            num_searched_moves++;
+
+            pos->do_move(move);
+            value = (WDLScore) -search(pos, result, false);
+            pos->undo_move();
+
+            if(*result == PROBE_FAIL)
+                return WDL_DRAW;
+
+            if(value > best_value)
+            {
+                best_value = value;
+                if(value >= WDL_WIN)
+                {
+                    *result = PROBE_ZEROING_BEST_MOVE;
+                    return value;
+                }
+            }
+        }
+
+        //If all moves were searched, the stored value could be wrong (e.g. en passent)
+        bool no_more_moves = num_searched_moves && num_searched_moves == num_moves;
+
+        if(no_more_moves)
+            value = best_value;
+        else
+        {
+            value = (WDLScore) probe_table(pos, WDL, result);
+            if(*result == PROBE_FAIL)
+                return WDL_DRAW;
+        }
+
+        if(best_value >= value)
+        {
+            *result = best_value > WDL_DRAW || no_more_moves ? PROBE_ZEROING_BEST_MOVE : PROBE_OK;
+            return best_value;
+        }
+
+        *result = PROBE_OK;
+        return value;
+    }
+
+    //The DTZ of the move before a capture or pawn move
+    int dtz_before_zeroing(WDLScore wdl)
+    {
+        return wdl == WDL_WIN          ?  1
+             : wdl == WDL_CURSED_WIN   ?  101
+             : wdl == WDL_BLESSED_LOSS ? -101
+             : wdl == WDL_LOSS         ? -1 : 0;
+    }
+
+    inline int sign_of(int value)
+    {
+        return (0 < value) - (value < 0);
+    }
+
+    //Adds the tables of both colors if the WDL file exists
+    void add_table(const std::string &white_pieces, const std::string &black_pieces)
+    {
+        std::string name = white_pieces + "v" + black_pieces;
+        if(find_file(name + ".rtbw").empty())
+            return;
+
+        int material[13] = { 0 };
+        for(char piece_char : white_pieces)
+            material[strchr(PIECE_CHARS, piece_char) - PIECE_CHARS]++;
+        for(char piece_char : black_pieces)
+            material[make_piece(strchr(PIECE_CHARS, piece_char) - PIECE_CHARS, black)]++;
+
+        Key key = material_signature(material);
+        if(find_table(key, WDL) != nullptr)
+            return;
+
+        Table *wdl = new Table();
+        wdl->type = WDL;
+        strcpy(wdl->name, name.c_str());
+        wdl->ready = false;
+        wdl->base_address = nullptr;
+        wdl->key = key;
+        wdl->piece_count = white_pieces.size() + black_pieces.size();
+        wdl->has_pawns = material[WHITE_PAWN] || material[BLACK_PAWN];
+
+        wdl->has_unique_pieces = false;
+        for(int piece = WHITE_PAWN; piece <= BLACK_QUEEN; piece++)
+            if(piece != WHITE_KING && material[piece] == 1)
+                wdl->has_unique_pieces = true;
+
+        //The leading color has fewer pawns, that compresses better
+        bool white_leads = !material[BLACK_PAWN] || (material[WHITE_PAWN] && material[BLACK_PAWN] >= material[WHITE_PAWN]);
+        wdl->pawn_count[0] = white_leads ? material[WHITE_PAWN] : material[BLACK_PAWN];
+        wdl->pawn_count[1] = white_leads ? material[BLACK_PAWN] : material[WHITE_PAWN];
+
+        int swapped[13] = { 0 };
+        for(int piece = WHITE_PAWN; piece <= BLACK_KING; piece++)
+            swapped[flip_color((Piece) piece)] = material[piece];
+        wdl->key2 = material_signature(swapped);
+
+        Table *dtz = new Table();
+        dtz->type = DTZ;
+        strcpy(dtz->name, wdl->name);
+        dtz->ready = false;
+        dtz->base_address = nullptr;
+        dtz->key = wdl->key;
+        dtz->key2 = wdl->key2;
+        dtz->piece_count = wdl->piece_count;
+        dtz->has_pawns = wdl->has_pawns;
+        dtz->has_unique_pieces = wdl->has_unique_pieces;
+        dtz->pawn_count[0] = wdl->pawn_count[0];
+        dtz->pawn_count[1] = wdl->pawn_count[1];
+
+        tables.push_back(wdl);
+        tables.push_back(dtz);
+        insert_table(wdl->key, wdl, dtz);
+        insert_table(wdl->key2, wdl, dtz);
+
+        if(wdl->piece_count > max_pieces)
+            max_pieces = wdl->piece_count;
+    }
+
+    void init_encoding()
+    {
+        int code = 0;
+        for(int s = a1; s <= h8; s++)
+            if(off_a1h8(s) < 0)
+                map_b1h1h7[s] = code++;
+
+        //The squares of the a1-d1-d4 triangle, the ones on the diagonal last
+        code = 0;
+        for(int s = a1; s <= d4; s++)
+            if(off_a1h8(s) < 0 && s % 8 <= 3)
+                map_a1d1d4[s] = code++;
+        for(int s = a1; s <= d4; s++)
+            if(!off_a1h8(s) && s % 8 <= 3)
+                map_a1d1d4[s] = code++;
+
+        //The 462 legal placements of two kings with the first one in the a1-d1-d4 triangle.
+        //If the first king is on the diagonal, the second one must not be above it
+        int both_on_diagonal[64][2];
+        int num_both_on_diagonal = 0;
+        code = 0;
+        for(int idx = 0; idx < 10; idx++)
+        {
+            for(int s1 = a1; s1 <= d4; s1++)
+            {
+                if(map_a1d1d4[s1] != idx || (!idx && s1 != b1))
+                    continue;
+
+                for(int s2 = a1; s2 <= h8; s2++)
+                {
+                    if((king_attack_bb((Square) s1) | (1ull << s1)) & (1ull << s2))
+                        continue;
+                    else if(!off_a1h8(s1) && off_a1h8(s2) > 0)
+                        continue;
+                    else if(!off_a1h8(s1) && !off_a1h8(s2))
+                    {
+                        both_on_diagonal[num_both_on_diagonal][0] = idx;
+                        both_on_diagonal[num_both_on_diagonal++][1] = s2;
+                    }
+                    else
+                        map_kk[idx][s2] = code++;
+                }
+            }
+        }
+
+        for(int i = 0; i < num_both_on_diagonal; i++)
+            map_kk[both_on_diagonal[i][0]][both_on_diagonal[i][1]] = code++;
+
+        binomial[0][0] = 1;
+        for(int n = 1; n < 64; n++)
+            for(int k = 0; k < 6 && k <= n; k++)
+                binomial[k][n] = (k > 0 ? binomial[k - 1][n - 1] : 0) + (k < n ? binomial[k][n - 1] : 0);
+
+        //map_pawns encodes the squares a2-h7 to 0..47, the highest value belongs to the leading pawn
+        int available_squares = 47;
+        for(int lead_pawns_count = 1; lead_pawns_count <= 5; lead_pawns_count++)
+        {
+            for(int file = 0; file < 4; file++)
+            {
+                int idx = 0;
+                for(int rank = 1; rank <= 6; rank++)
+                {
+                    int s = 8 * rank + file;
+                    if(lead_pawns_count == 1)
+                    {
+                        map_pawns[s] = available_squares--;
+                        map_pawns[s ^ 7] = available_squares--;
+                    }
+                    lead_pawn_idx[lead_pawns_count][s] = idx;
+                    idx += binomial[lead_pawns_count - 1][map_pawns[s]];
+                }
+                lead_pawns_size[lead_pawns_count][file] = idx;
+            }
+        }
+    }
+
+    void init(const char *path)
+    {
+        for(Table *table : tables)
+        {
+            unmap(table);
+            delete table;
+        }
+        tables.clear();
+        memset(table_slots, 0, sizeof(table_slots));
+        paths.clear();
+        max_pieces = 0;
+
+        if(path == nullptr || !*path || !strcmp(path, "<empty>"))
+            return;
+
+#ifdef _WIN32
+        const char SEPARATOR = ';';
+#else
+        const char SEPARATOR = ':';
+#endif
+        std::string path_list(path);
+        size_t start = 0;
+        while(start <= path_list.size())
+        {
+            size_t end = path_list.find(SEPARATOR, start);
+            if(end == std::string::npos)
+                end = path_list.size();
+            if(end > start)
+                paths.push_back(path_list.substr(start, end - start));
+            start = end + 1;
+        }
+
+        init_encoding();
+
+        //All piece sets of one side, a king and up to TB_PIECES - 2 other pieces ordered like KQRBNP
+        std::vector<std::string> sides;
+        for(int q = 0; q <= TB_PIECES - 2; q++)
+        for(int r = 0; q + r <= TB_PIECES - 2; r++)
+        for(int b = 0; q + r + b <= TB_PIECES - 2; b++)
+        for(int n = 0; q + r + b + n <= TB_PIECES - 2; n++)
+        for(int p = 0; q + r + b + n + p <= TB_PIECES - 2; p++)
+            sides.push_back("K" + std::string(q, 'Q') + std::string(r, 'R') + std::string(b, 'B') + std::string(n, 'N') + std::string(p, 'P'));
+
+        for(const std::string &white_pieces : sides)
+            for(const std::string &black_pieces : sides)
+                if(white_pieces.size() + black_pieces.size() <= TB_PIECES && white_pieces.size() + black_pieces.size() > 2)
+                    add_table(white_pieces, black_pieces);
+
+        printf("info string Found %i tablebases\n", (int) tables.size() / 2);
+        if(!tables.empty())
+            printf("info string Syzygy probing is experimental, verify the tables with tbcheck\n");
+        fflush(stdout);
+    }
+
+    WDLScore probe_wdl(Position *pos, ProbeState *result)
+    {
+        *result = PROBE_OK;
+        return search(pos, result, false);
+    }
+
+    //Returns the DTZ from the point of view of the side to move:
+    //         n < -100 : loss, but draw under the 50 moves rule
+    // -100 <= n < -1   : loss in n plies (assuming the 50 moves counter is 0)
+    //        -1        : loss, the side to move is mated
+    //         0        : draw
+    //     1 < n <= 100 : win in n plies (assuming the 50 moves counter is 0)
+    //   100 < n        : win, but draw under the 50 moves rule
+    //The value can be off by one ply
+    int probe_dtz(Position *pos, ProbeState *result)
+    {
+        *result = PROBE_OK;
+        WDLScore wdl = search(pos, result, true);
+
+        //Draws are not stored
+        if(*result == PROBE_FAIL || wdl == WDL_DRAW)
+            return 0;
+
+        if(*result == PROBE_ZEROING_BEST_MOVE)
+            return dtz_before_zeroing(wdl);
+
+        int dtz = probe_table(pos, DTZ, result, wdl);
+
+        if(*result == PROBE_FAIL)
+            return 0;
+
+        if(*result != PROBE_CHANGE_STM)
+            return (dtz + 100 * (wdl == WDL_BLESSED_LOSS || wdl == WDL_CURSED_WIN)) * sign_of(wdl);
+
+        //The table stores the other side to move, so search one ply for the move with the best DTZ
+        int min_dtz = INT_MAX;
+
+        MoveList moves(pos, false);
+        for(int i = 0; i < moves.size; i++)
+        {
+            Move move = moves.moveList[i].move;
+            if(!pos->is_legal(move))
+                continue;
+
+            bool zeroing = is_zeroing(move);
+
+            pos->do_move(move);
+
+            //For zeroing moves we need the DTZ before the move, the sign comes from the WDL after it
+            dtz = zeroing ? -dtz_before_zeroing(search(pos, result, false))
+                          : -probe_dtz(pos, result);
+
+            //The move mates
+            if(dtz == 1 && pos->current_state->in_check && !has_legal_move(pos))
+                min_dtz = 1;
+
+            if(!zeroing)
+                dtz += sign_of(dtz);
+
+            if(dtz < min_dtz && sign_of(dtz) == sign_of(wdl))
+                min_dtz = dtz;
+
+            pos->undo_move();
+
+            if(*result == PROBE_FAIL)
+                return 0;
+        }
+
+        //Without legal moves we are mated
+        return min_dtz == INT_MAX ? -1 : min_dtz;
+    }
+
+    //Returns true if a position occured twice since the last capture or pawn move
+    bool has_repeated(Position *pos)
+    {
+        for(State *state = pos->current_state; state != nullptr && state->fifty_moves > 0; state = state->last_state)
+        {
+            for(State *earlier = state->last_state; earlier != nullptr; earlier = earlier->last_state)
+            {
+                if(earlier->position_key == state->position_key)
+                    return true;
+                if(earlier->fifty_moves == 0)
+                    break;
+            }
+        }
+        return false;
+    }
+
+    bool root_probe(Position *pos, Move *root_moves, int *num_root_moves)
+    {
+        ProbeState result;
+        int dtz = probe_dtz(pos, &result);
+        if(result == PROBE_FAIL)
+            return false;
+
+        //The DTZ after every root move, from our point of view
+        int scores[256];
+        for(int i = 0; i < *num_root_moves; i++)
+        {
+            Move move = root_moves[i];
+            pos->do_move(move);
+
+            int value = 0;
+            if(pos->current_state->in_check && dtz > 0 && !has_legal_move(pos))
+                value = 1;
+            else if(pos->current_state->fifty_moves != 0)
+            {
+                value = -probe_dtz(pos, &result);
+                value += sign_of(value);
+            }
+            else
+                value = dtz_before_zeroing((WDLScore) -probe_wdl(pos, &result));
+
+            pos->undo_move();
+
+            if(result == PROBE_FAIL)
+                return false;
+
+            scores[i] = value;
+        }
+
+        int fifty_moves = pos->current_state->fifty_moves;
+        int num_kept = 0;
+
+        if(dtz > 0)
+        {
+            //Winning: keep the moves which win fastest. If there is enough time left, all moves that win within the 50 moves rule
+            int best = 0xFFFF;
+            for(int i = 0; i < *num_root_moves; i++)
+                if(scores[i] > 0 && scores[i] < best)
+                    best = scores[i];
+
+            int max = best;
+            if(!has_repeated(pos) && best + fifty_moves <= 99)
+                max = 99 - fifty_moves;
+
+            for(int i = 0; i < *num_root_moves; i++)
+                if(scores[i] > 0 && scores[i] <= max)
+                    root_moves[num_kept++] = root_moves[i];
+        }
+        else if(dtz < 0)
+        {
+            //Losing: try all moves unless the 50 moves rule could save us, then keep the longest resistance
+            int best = 0;
+            for(int i = 0; i < *num_root_moves; i++)
+                if(scores[i] < best)
+                    best = scores[i];
+
+            if(-best * 2 + fifty_moves < 100)
+                return true;
+
+            for(int i = 0; i < *num_root_moves; i++)
+                if(scores[i] == best)
+                    root_moves[num_kept++] = root_moves[i];
+        }
+        else
+        {
+            //Drawing: keep the moves that preserve the draw
+            for(int i = 0; i < *num_root_moves; i++)
+                if(scores[i] == 0)
+                    root_moves[num_kept++] = root_moves[i];
+        }
+
+        if(num_kept == 0)
+            return false;
+
+        *num_root_moves = num_kept;
+        return true;
+    }
+
+    //The DTZ of a check position is only compared if it is certain
+    const int DTZ_UNCHECKED = INT_MAX;
+
+    struct CheckPosition
+    {
+        const char *fen;
+        WDLScore wdl;
+        int dtz;
+    };
+
+    //Results from the point of view of the side to move, found by hand and (KPvK) with the KPK bitbase.
+    //The DTZ is checked for mates in one and two, draws and winning pawn moves or captures
+    const CheckPosition CHECK_POSITIONS[] = {
+        //KRvK: mate in one, mated in two plies, the rook can be taken
+        { "7k/8/6K1/8/8/8/8/R7 w - - 0 1", WDL_WIN, 1 },
+        { "7k/1R6/6K1/8/8/8/8/8 b - - 0 1", WDL_LOSS, -2 },
+        { "k7/1R6/8/8/8/8/8/K7 b - - 0 1", WDL_DRAW, 0 },
+        //KPvK: the king on the sixth rank in front of the pawn wins, except with a rook pawn
+        { "1k6/8/1K6/1P6/8/8/8/8 w - - 0 1", WDL_WIN, DTZ_UNCHECKED },
+        { "1k6/8/1K6/1P6/8/8/8/8 b - - 0 1", WDL_LOSS, DTZ_UNCHECKED },
+        { "3k4/8/3K4/3P4/8/8/8/8 b - - 0 1", WDL_LOSS, DTZ_UNCHECKED },
+        { "6k1/8/6K1/6P1/8/8/8/8 w - - 0 1", WDL_WIN, DTZ_UNCHECKED },
+        { "k7/8/K7/P7/8/8/8/8 w - - 0 1", WDL_DRAW, 0 },
+        { "8/4P3/8/8/8/8/8/K6k w - - 0 1", WDL_WIN, 1 },
+        { "8/7P/8/8/8/8/8/k6K w - - 0 1", WDL_WIN, 1 },
+        { "3k4/4P3/8/8/8/8/8/K7 b - - 0 1", WDL_DRAW, 0 },
+        //KBNvK
+        { "4k3/8/8/8/8/8/8/1NB1K3 w - - 0 1", WDL_WIN, DTZ_UNCHECKED },
+        { "4k3/8/8/8/8/8/8/1NB1K3 b - - 0 1", WDL_LOSS, DTZ_UNCHECKED },
+        //KRvKP, a table with pieces on both sides: the pawn is lost, or it wins after taking the rook
+        { "7k/p7/8/8/4K3/8/8/3R4 w - - 0 1", WDL_WIN, DTZ_UNCHECKED },
+        { "7k/p7/8/8/4K3/8/8/3R4 b - - 0 1", WDL_LOSS, DTZ_UNCHECKED },
+        { "K7/8/8/4k3/3R3p/8/8/8 b - - 0 1", WDL_WIN, 1 },
+        //KQRvK
+        { "4k3/8/8/8/8/8/8/R2QK3 w - - 0 1", WDL_WIN, DTZ_UNCHECKED },
+        { "4k3/8/8/8/8/8/8/R2QK3 b - - 0 1", WDL_LOSS, DTZ_UNCHECKED },
+    };
+
+    int check()
+    {
+        int num_checked = 0;
+        int num_skipped = 0;
+        int num_mismatches = 0;
+
+        for(const CheckPosition &check_position : CHECK_POSITIONS)
+        {
+            Position *pos = new Position();
+            std::string fen(check_position.fen);
+            pos->init(fen);
+
+            ProbeState wdl_result = PROBE_FAIL;
+            ProbeState dtz_result = PROBE_FAIL;
+            WDLScore wdl = WDL_DRAW;
+            int dtz = 0;
+            if(popcount(pos->color_bitboard[white] | pos->color_bitboard[black]) <= max_pieces)
+            {
+                wdl = probe_wdl(pos, &wdl_result);
+                dtz = probe_dtz(pos, &dtz_result);
+            }
+
+            if(wdl_result == PROBE_FAIL || dtz_result == PROBE_FAIL)
+            {
+                printf("info string tbcheck skipped %s, tables missing\n", check_position.fen);
+                num_skipped++;
+            }
+            else
+            {
+                num_checked++;
+                //Without an exact DTZ, at least its sign has to match the result
+                bool dtz_ok = check_position.dtz != DTZ_UNCHECKED ? dtz == check_position.dtz : sign_of(dtz) == sign_of(wdl);
+                if(wdl != check_position.wdl || !dtz_ok)
+                {
+                    printf("info string tbcheck mismatch %s: wdl %i dtz %i, expected wdl %i", check_position.fen, wdl, dtz, check_position.wdl);
+                    if(check_position.dtz != DTZ_UNCHECKED)
+                        printf(" dtz %i", check_position.dtz);
+                    printf("\n");
+                    num_mismatches++;
+                }
+            }
+
+            delete pos->current_state;
+            delete pos;
+        }
+
+        printf("info string tbcheck %i positions checked, %i skipped, %i mismatches\n", num_checked, num_skipped, num_mismatches);
+        fflush(stdout);
+        return num_mismatches;
+    }
+}
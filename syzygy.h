@@ -0,0 +1,50 @@
+#ifndef SYZYGY_H
+#define SYZYGY_H
+
+#include "types.h"
+#include "position.h"
+
+namespace syzygy
+{
+    //Maximum number of pieces (kings included) of a Syzygy tablebase
+    const int TB_PIECES = 7;
+
+    //Results from the point of view of the side to move. Cursed wins and blessed losses are draws by the 50 moves rule
+    enum WDLScore
+    {
+        WDL_LOSS = -2, WDL_BLESSED_LOSS = -1, WDL_DRAW = 0, WDL_CURSED_WIN = 1, WDL_WIN = 2
+    };
+
+    enum ProbeState
+    {
+        PROBE_FAIL = 0,              //The probe failed (missing file)
+        PROBE_OK = 1,                //The probe was successful
+        PROBE_CHANGE_STM = -1,       //The DTZ table stores the other side to move
+        PROBE_ZEROING_BEST_MOVE = 2  //The best move is a capture or a pawn move
+    };
+
+    //Largest number of pieces of the tablebases found, 0 if there are none
+    extern int max_pieces;
+
+    //Looks for the tablebase files in the directories of path, separated by ':' (';' on Windows).
+    //The files are memory mapped when they are probed for the first time. Must not be called during a search.
+    //Experimental: the decoder has not been verified on the real table files yet, see check
+    void init(const char *path);
+
+    //Returns the result of the position with the best play of both sides. Thread-safe.
+    //Castling rights are not supported, the 50 moves counter is ignored
+    WDLScore probe_wdl(Position *pos, ProbeState *result);
+
+    //Returns the distance (in plies) to the next capture or pawn move that keeps the result, see syzygy.cpp
+    int probe_dtz(Position *pos, ProbeState *result);
+
+    //Keeps only the root moves which preserve the result according to the DTZ tables and make progress.
+    //Returns false if the tables are not available, the moves are not changed then
+    bool root_probe(Position *pos, Move *root_moves, int *num_root_moves);
+
+    //Probes built-in 3 to 5 piece positions with known results and reports every mismatch as an info string.
+    //Positions without their tables are skipped. Returns the number of mismatches, init has to be called before
+    int check();
+}
+
+#endif //!SYZYGY_H
@@ -0,0 +1,52 @@
+#include <algorithm>
+
+#include "timeman.h"
+
+namespace timeman
+{
+    void allocate(SearchLimits *limits, Color us)
+    {
+        limits->soft_time = -1;
+        limits->hard_time = -1;
+
+        if(limits->infinite)
+            return;
+
+        //The GUI asked for a fixed time, use all of it
+        if(limits->move_time > 0)
+        {
+            limits->hard_time = std::max(1, limits->move_time - MOVE_OVERHEAD);
+            return;
+        }
+
+        if(limits->time[us] <= 0)
+            return;
+
+        int time_left = std::max(1, limits->time[us] - MOVE_OVERHEAD);
+        int moves_to_go = limits->moves_to_go > 0 ? std::min(limits->moves_to_go, MAX_MOVES_TO_GO) : DEFAULT_MOVES_TO_GO;
+
+        //Spend an equal share of the clock on every move, most of the increment comes back anyway
+        int soft_time = time_left / moves_to_go + limits->increment[us] * 3 / 4;
+
+        //Iterations which fail low may run over the soft limit, but must never cost the game.
+        //The last move before the time control may use almost everything
+        int hard_time = std::min(4 * soft_time, moves_to_go == 1 ? time_left * 9 / 10 : time_left / 3);
+
+        limits->hard_time = std::max(1, hard_time);
+        limits->soft_time = std::max(1, std::min(soft_time, hard_time));
+    }
+
+    float soft_time_factor(int stable_iterations, int aspiration_failures, bool failed_low)
+    {
+        //A best move that keeps changing needs more time, a stable one less
+        float factor = 1.2f - 0.1f * std::min(stable_iterations, 8);
+
+        //The score dropped: look for a better move before the hard limit
+        if(failed_low)
+            factor *= 1.5f;
+
+        factor *= 1.0f + 0.1f * std::min(aspiration_failures, 5);
+
+        return factor;
+    }
+}
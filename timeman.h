@@ -0,0 +1,25 @@
+#ifndef TIMEMAN_H
+#define TIMEMAN_H
+
+#include "types.h"
+#include "search.h"
+
+namespace timeman
+{
+    //Milliseconds kept on the clock for the communication with the GUI
+    const int MOVE_OVERHEAD = 30;
+
+    //Number of moves we plan for if the GUI does not send movestogo
+    const int DEFAULT_MOVES_TO_GO = 30;
+    const int MAX_MOVES_TO_GO = 50;
+
+    //Sets the soft and hard time limits from the clock of the side to move (or from movetime).
+    //Without a clock the limits are left unlimited
+    void allocate(SearchLimits *limits, Color us);
+
+    //Factor for the soft time limit after an iteration. stable_iterations counts the iterations in a row
+    //which kept the best move, aspiration_failures and failed_low describe the last iteration
+    float soft_time_factor(int stable_iterations, int aspiration_failures, bool failed_low);
+}
+
+#endif //!TIMEMAN_H
@@ -0,0 +1,47 @@
+#include <stdio.h>
+
+#include "trace.h"
+
+#ifdef TRACE
+
+namespace trace
+{
+    thread_local uint64_t cycles[NUM_PHASES];
+    thread_local uint64_t calls[NUM_PHASES];
+
+    thread_local uint64_t search_start;
+
+    const char *PHASE_NAMES[NUM_PHASES] = {
+        "search", "movegen", "compute_bitboards", "evaluate", "tt_probe", "tt_store", "move_picker"
+    };
+
+    void reset()
+    {
+        for(int phase = 0; phase < NUM_PHASES; phase++)
+        {
+            cycles[phase] = 0;
+            calls[phase] = 0;
+        }
+        search_start = now();
+    }
+
+    void report()
+    {
+        cycles[SEARCH] = now() - search_start;
+        calls[SEARCH] = 1;
+
+        uint64_t total = cycles[SEARCH] > 0 ? cycles[SEARCH] : 1;
+        for(int phase = 0; phase < NUM_PHASES; phase++)
+        {
+            printf("info string trace %s %llu kcycles %.1f%% calls %llu cycles/call %.1f\n",
+                PHASE_NAMES[phase],
+                (unsigned long long) cycles[phase] / 1000,
+                100.0 * cycles[phase] / total,
+                (unsigned long long) calls[phase],
+                calls[phase] > 0 ? (double) cycles[phase] / calls[phase] : 0.0);
+        }
+        fflush(stdout);
+    }
+}
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+//Cycle counts of the hot phases of the search, only compiled with -DTRACE (make trace).
+//Without it TRACE_SCOPE(...) disappears and nothing of this header is used
+#ifdef TRACE
+
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <time.h>
+#endif
+
+namespace trace
+{
+    //The phases nest (the move picker generates moves, do_move computes bitboards), so the cycles are inclusive
+    enum Phase
+    {
+        SEARCH, MOVEGEN, COMPUTE_BITBOARDS, EVALUATE, TT_PROBE, TT_STORE, MOVE_PICKER, NUM_PHASES
+    };
+
+    //Accumulated cycles and calls of the phases, per thread
+    extern thread_local uint64_t cycles[NUM_PHASES];
+    extern thread_local uint64_t calls[NUM_PHASES];
+
+    inline uint64_t now()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        timespec time;
+        clock_gettime(CLOCK_MONOTONIC, &time);
+        return time.tv_sec * 1000000000ull + time.tv_nsec;
+#endif
+    }
+
+    //Adds the time between construction and destruction to the phase
+    struct Scope
+    {
+        Phase phase;
+        uint64_t start;
+
+        Scope(Phase phase) : phase(phase), start(now()) {}
+        ~Scope()
+        {
+            cycles[phase] += now() - start;
+            calls[phase]++;
+        }
+    };
+
+    //Clears the accumulators of the calling thread and starts the search phase
+    void reset();
+
+    //Ends the search phase and sends the cycles of every phase and its share of the search as info strings
+    void report();
+}
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(phase) trace::Scope TRACE_CONCAT(trace_scope_, __LINE__)(phase)
+
+#else
+
+#define TRACE_SCOPE(phase)
+
+#endif
+
+#endif //!TRACE_H
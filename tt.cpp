@@ -1,6 +1,8 @@
+#include <string.h>
+
 #include "tt.h"
-#include "movegen.h"
 #include "search.h"
+#include "trace.h"
 
 int TranspositionTableEntry::get_score(int alpha, int beta, Depth depth)
 {
@@ -23,6 +25,7 @@ int TranspositionTableEntry::get_score(int alpha, int beta, Depth depth)
 
 TranspositionTableEntry *TranspositionTable::get_entry(Key key)
 {
+    TRACE_SCOPE(trace::TT_PROBE);
     Key index = key & (this->num_entries - 1);
     TranspositionTableEntry entry = this->data[index];
     if(entry.key == key)
@@ -33,9 +36,17 @@ TranspositionTableEntry *TranspositionTable::get_entry(Key key)
     return nullptr;
 }
 
+void TranspositionTable::clear()
+{
+    memset(this->data, 0, this->num_entries * sizeof(TranspositionTableEntry));
+    this->used_entries = 0;
+    this->collissions = 0;
+    this->hits = 0;
+}
 
 void TranspositionTable::store(Key key, TranspositionTableEntryType type, int score, Move pv_move, Depth depth, int insertion_ply)
 {
+    TRACE_SCOPE(trace::TT_STORE);
     Key index = key & (this->num_entries - 1);
     if(this->data[index].key == 0)
     {
@@ -110,39 +121,3 @@ void TranspositionTable::store(Key key, TranspositionTableEntryType type, int sc
         }
     }
 }
-
-int TranspositionTable::find_pv(Position *pos, Move *pv)
-{
-    int num_pv_moves = 0;
-
-    TranspositionTableEntry *entry;
-    while((entry = this->get_entry(pos->current_state->position_key)) != nullptr)
-    {
-        if(entry->type != Exact) break;
-        if(entry->pv_move == 0)
-        {
-            printf("Exact stored no move?\n");
-            break;
-        }
-
-        //Check if move exists and is legal (to avoid key hash hits)
-        MoveList moves(pos, false);
-        bool exists = false;
-        for(int i = 0; i < moves.size; i++)
-            if(moves.moveList[i].move == entry->pv_move)
-                exists = true;
-        if(!exists || !pos->is_legal(entry->pv_move))
-            break;
-
-        num_pv_moves++;
-        pos->do_move(entry->pv_move);
-        *pv = entry->pv_move;
-        pv++;
-        if(num_pv_moves >= MAX_PV_LENGTH)
-            break; //Only store MAX_PV_LENGTH many pv moves
-    }
-
-    for(int i = 0; i < num_pv_moves; i++)
-        pos->undo_move();
-    return num_pv_moves;
-}
\ No newline at end of file
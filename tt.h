@@ -44,7 +44,8 @@ struct TranspositionTable
         ASSERT(this->num_entries > 0);
         this->data = (TranspositionTableEntry *)calloc(this->num_entries, sizeof(TranspositionTableEntry));
         ASSERT(this->data != nullptr);
-        printf("initialized table with %llu entries\n", this->num_entries);
+        //Not on stdout, which belongs to the GUI (and to the JSON of the microbenchmarks)
+        fprintf(stderr, "initialized table with %zu entries\n", this->num_entries);
     }
     ~TranspositionTable()
     {
@@ -52,7 +53,8 @@ struct TranspositionTable
     }
     TranspositionTableEntry *get_entry(Key key);
     void store(Key key, TranspositionTableEntryType type, int score, Move pv_move, Depth depth, int insertion_ply);
-    int find_pv(Position *pos, Move *pv);
+    //Removes all entries
+    void clear();
     float get_used_percentage() { return used_entries / (float)num_entries; }
     int get_used() {return used_entries; }
     int collissions = 0;
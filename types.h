@@ -12,7 +12,7 @@ enum Color {
     white, black
 };
 
-inline Color operator~(Color c){
+constexpr Color operator~(Color c){
     return (Color) (1 - (int) c);
 }
 
@@ -116,6 +116,8 @@ const unsigned int IS_DOUBLE_PAWN_MASK = 0x1 << IS_DOUBLE_PAWN_INDEX;
 #define is_en_passent(move) (move & IS_EN_PASSENT_MASK)
 #define is_casteling(move) (move & IS_CASTELING_MASK)
 #define is_double_pawn(move) (move & IS_DOUBLE_PAWN_MASK)
+//Neither a capture nor a promotion
+#define is_quiet(move) (!(move & (CAPTURED_MASK | IS_PROMOTION_MASK | IS_EN_PASSENT_MASK)))
 
 #define make_move(from, to, moved, captured) ((from << FROM_INDEX) | (to << TO_INDEX) | (moved << MOVED_INDEX) | (captured << CAPTURED_INDEX))
 #define make_move_promotion(from, to, moved, captured, promoted) ((from << FROM_INDEX) | (to << TO_INDEX) | (moved << MOVED_INDEX) | (captured << CAPTURED_INDEX) | ((promoted - (int) KNIGHT) << PROMOTED_INDEX) | IS_PROMOTION_MASK)
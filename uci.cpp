@@ -1,13 +1,19 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
+#include <algorithm>
 #include <chrono>
+#include <thread>
 
 #include "uci.h"
 #include "position.h"
 #include "movegen.h"
 #include "search.h"
+#include "syzygy.h"
+#include "timeman.h"
 #include "io.h"
+#include "bench.h"
 
 
 #define INPUTBUFFER 400 * 6
@@ -16,20 +22,22 @@ namespace uci
 {
     void send_best_move(Move best_move)
     {
-        printf("bestmove %s\n", io::move_to_string(best_move));
+        //The null move tells the GUI that there is no legal move
+        printf("bestmove %s\n", best_move != NO_MOVE ? io::move_to_string(best_move) : "0000");
         fflush(stdout);
     }
 
     void send_depth_info(SearchResult *res, int nps)
     {
+        //The pv is left out if there is no move (mate or stalemate at the root)
         char *pv_string = (char *) malloc(2048);
-        sprintf(pv_string, "%s", io::move_to_string(res->pv[0]));
-        for(int i = 1; i < res->pv_length; i++)
+        pv_string[0] = '\0';
+        for(int i = 0; i < res->pv_length; i++)
         {
             sprintf(pv_string, "%s %s", pv_string, io::move_to_string(res->pv[i]));
         }
 
-        printf("info depth %i nodes %li score cp %i pv %s nps %i\n", res->search_depth, res->nodes, res->score, pv_string, nps);
+        printf("info depth %i nodes %li score cp %i%s%s nps %i tbhits %li\n", res->search_depth, res->nodes, res->score, res->pv_length > 0 ? " pv" : "", pv_string, nps, res->tb_hits);
         fflush(stdout);
 
         free(pv_string);
@@ -47,11 +55,48 @@ namespace uci
         fflush(stdout);  
     }
 
+#ifdef SEARCH_STATS
+    //Share in percent, 0 if there was nothing to count
+    inline float percentage(long int part, long int total)
+    {
+        return total > 0 ? 100.0f * part / total : 0.0f;
+    }
+
+    void send_search_stats(SearchResult *res, long int last_iteration_nodes)
+    {
+        SearchStats *stats = &res->stats;
+        printf("info string stats depth %i nodes %li qnodes %.1f%% ebf %.2f aspiration researches %i\n",
+            res->search_depth, stats->nodes, percentage(stats->qnodes, stats->nodes),
+            last_iteration_nodes > 0 ? stats->nodes / (float) last_iteration_nodes : 0.0f,
+            stats->aspiration_researches);
+        printf("info string stats tt probes %li hits %.1f%% cutoffs %.1f%%\n",
+            stats->tt_probes, percentage(stats->tt_hits, stats->tt_probes), percentage(stats->tt_cutoffs, stats->tt_probes));
+        printf("info string stats null move %.1f%% of %li, futility %.1f%% of %li, multicut %.1f%% of %li, lmr researches %.1f%% of %li\n",
+            percentage(stats->null_move_cutoffs, stats->null_move_tries), stats->null_move_tries,
+            percentage(stats->futility_prunes, stats->futility_tries), stats->futility_tries,
+            percentage(stats->multicut_cutoffs, stats->multicut_tries), stats->multicut_tries,
+            percentage(stats->lmr_researches, stats->lmr_searches), stats->lmr_searches);
+        printf("info string stats reverse futility %li cutoffs, razoring %.1f%% of %li, probcut %.1f%% of %li\n",
+            stats->reverse_futility_cutoffs,
+            percentage(stats->razoring_cutoffs, stats->razoring_tries), stats->razoring_tries,
+            percentage(stats->probcut_cutoffs, stats->probcut_tries), stats->probcut_tries);
+        printf("info string stats first move cutoffs pv %.1f%% of %li, cut %.1f%% of %li, all %.1f%% of %li\n",
+            percentage(stats->first_move_cutoffs[PV + 1], stats->cutoffs[PV + 1]), stats->cutoffs[PV + 1],
+            percentage(stats->first_move_cutoffs[Cut + 1], stats->cutoffs[Cut + 1]), stats->cutoffs[Cut + 1],
+            percentage(stats->first_move_cutoffs[All + 1], stats->cutoffs[All + 1]), stats->cutoffs[All + 1]);
+        fflush(stdout);
+    }
+#endif
 
     void init()
     {
         printf("id name CHESS-TEST-V1\n");
         printf("id author Klaus Mattis\n");   
+        printf("option name SyzygyPath type string default <empty>\n");
+        printf("option name ReverseFutility type check default true\n");
+        printf("option name Razoring type check default true\n");
+        printf("option name ProbCut type check default true\n");
+        printf("option name HashMoveSearch type combo default IIR var None var IID var IIR\n");
         printf("uciok\n");
     }
 
@@ -89,6 +134,22 @@ namespace uci
         printf("Move not found! Maybe not valid? %s\n", io::move_to_string(make_move(from, to, NO_PIECE, NO_PIECE)));
     }
 
+    //Makes the moves of a space separated list
+    void parse_moves(char *ptr_char, Position *pos)
+    {
+        while(*ptr_char)
+        {
+            while(*ptr_char == ' ')
+                ptr_char++;
+            if(!*ptr_char)
+                break;
+
+            parse_and_make_move(ptr_char, pos);
+            while(*ptr_char && *ptr_char != ' ')
+                ptr_char++;
+        }
+    }
+
     void parse_pos(char *line, Position *pos)
     {
         char *ptr_char = line + 9;
@@ -104,21 +165,140 @@ namespace uci
 
         ptr_char = strstr(line, "moves");
 
-        if(ptr_char != NULL) {
-            ptr_char += 6;
-            while(*ptr_char) {
-                parse_and_make_move(ptr_char, pos);
-                while(*ptr_char && *ptr_char != ' ')
-                    ptr_char++;
-                ptr_char++;
-            }
+        if(ptr_char != NULL)
+            parse_moves(ptr_char + 5, pos);
+    }
+
+    //Moves of the last position command, the position was set up by replaying them from the start position.
+    //Empty if the last command had no moves, not valid for other positions
+    string game_moves;
+    bool game_moves_valid = false;
+
+    //Sets up the position of a "position" command. During a game the GUI repeats all moves every time,
+    //so if they extend the moves of the last command only the new moves are made
+    void update_position(char *line, Position **pos)
+    {
+        line[strcspn(line, "\r\n")] = 0;
+
+        char *moves = strstr(line, "moves");
+        string new_moves(moves != NULL ? moves + 5 : "");
+        bool is_startpos = !strncmp(line + 9, "startpos", 8);
+
+        if(is_startpos
+            && game_moves_valid
+            && !new_moves.compare(0, game_moves.size(), game_moves)
+            && (new_moves.size() == game_moves.size() || new_moves[game_moves.size()] == ' '))
+        {
+            if(moves != NULL)
+                parse_moves(moves + 5 + game_moves.size(), *pos);
+        }
+        else
+        {
+            delete *pos;
+            *pos = new Position();
+            parse_pos(line, *pos);
+        }
+
+        game_moves = new_moves;
+        game_moves_valid = is_startpos;
+    }
+
+    //Parses "setoption name <name> value <value>"
+    void set_option(char *line)
+    {
+        char *name = strstr(line, "name ");
+        char *value = strstr(line, "value ");
+        if(name == NULL)
+            return;
+
+        //Strip the line break
+        line[strcspn(line, "\r\n")] = 0;
+
+        if(!strncmp(name + 5, "SyzygyPath", 10))
+            syzygy::init(value != NULL ? value + 6 : "");
+
+        bool enabled = value != NULL && !strncmp(value + 6, "true", 4);
+        if(!strncmp(name + 5, "ReverseFutility", 15))
+            pruning_options.reverse_futility = enabled;
+        else if(!strncmp(name + 5, "Razoring", 8))
+            pruning_options.razoring = enabled;
+        else if(!strncmp(name + 5, "ProbCut", 7))
+            pruning_options.probcut = enabled;
+        else if(!strncmp(name + 5, "HashMoveSearch", 14) && value != NULL)
+        {
+            if(!strncmp(value + 6, "IID", 3))
+                pruning_options.hash_move_search = HASH_MOVE_IID;
+            else if(!strncmp(value + 6, "IIR", 3))
+                pruning_options.hash_move_search = HASH_MOVE_IIR;
+            else
+                pruning_options.hash_move_search = HASH_MOVE_NONE;
         }
     }
 
-    void go(Position *pos)
+    //Runs the search, only one search is active at a time
+    std::thread search_thread;
+
+    //Waits for the running search to send its best move
+    void wait_for_search()
+    {
+        if(search_thread.joinable())
+            search_thread.join();
+    }
+
+    void stop_search()
+    {
+        search_controller.stop.store(true);
+        wait_for_search();
+    }
+
+    //Parses "go [wtime <x>] [btime <x>] [winc <x>] [binc <x>] [movestogo <x>] [movetime <x>] [depth <x>] [nodes <x>] [infinite]"
+    void go(char *line, Position *pos)
     {
-        //Todo read timeleft
-        do_search(6, 40, pos, 15000);
+        SearchLimits limits;
+        memset(&limits, 0, sizeof(limits));
+        limits.depth = MAX_DEPTH;
+
+        char *token = strtok(line + 2, " \r\n");
+        while(token != NULL)
+        {
+            char *value = strtok(NULL, " \r\n");
+            bool has_value = value != NULL;
+
+            if(!strcmp(token, "wtime") && has_value)
+                limits.time[white] = atoi(value);
+            else if(!strcmp(token, "btime") && has_value)
+                limits.time[black] = atoi(value);
+            else if(!strcmp(token, "winc") && has_value)
+                limits.increment[white] = atoi(value);
+            else if(!strcmp(token, "binc") && has_value)
+                limits.increment[black] = atoi(value);
+            else if(!strcmp(token, "movestogo") && has_value)
+                limits.moves_to_go = atoi(value);
+            else if(!strcmp(token, "movetime") && has_value)
+                limits.move_time = atoi(value);
+            else if(!strcmp(token, "depth") && has_value)
+                limits.depth = std::max(1, std::min(atoi(value), (int) MAX_DEPTH));
+            else if(!strcmp(token, "nodes") && has_value)
+                limits.nodes = atol(value);
+            else
+            {
+                //Flags like "infinite" have no value, the next token is a parameter again
+                if(!strcmp(token, "infinite"))
+                    limits.infinite = true;
+                else if(!strcmp(token, "ponder"))
+                    limits.ponder = true;
+                token = value;
+                continue;
+            }
+
+            token = strtok(NULL, " \r\n");
+        }
+
+        timeman::allocate(&limits, pos->color_to_move);
+
+        //The clock starts now, the loop keeps reading commands while the worker searches
+        search_controller.start(&limits);
+        search_thread = std::thread(do_search, 1, pos);
     }
 
     void loop()
@@ -127,13 +307,20 @@ namespace uci
 
         Position *pos = new Position();
         parse_pos("position startpos\n", pos);
+        game_moves_valid = true;
 
         while(true)
         {
             fflush(stdout);
             memset(&line[0], 0, sizeof(line));
             if(!fgets(line, INPUTBUFFER, stdin))
-                continue;
+            {
+                //End of input: nobody can send stop anymore, so only searches with limits may finish
+                if(search_controller.limits.infinite || search_controller.limits.ponder)
+                    search_controller.stop.store(true);
+                wait_for_search();
+                break;
+            }
 
             if(line[0] == '\n')
                 continue;
@@ -141,18 +328,38 @@ namespace uci
             if (!strncmp(line, "isready", 7)) {
                 printf("readyok\n");
                 continue;
+            } else if (!strncmp(line, "stop", 4)) {
+                stop_search();
+            } else if (!strncmp(line, "ponderhit", 9)) {
+                search_controller.ponderhit();
             } else if (!strncmp(line, "position", 8)) {
-                delete pos;
-                pos = new Position();
-                parse_pos(line, pos);
+                stop_search();
+                update_position(line, &pos);
             } else if (!strncmp(line, "ucinewgame", 10)) {
+                stop_search();
                 delete pos;
                 pos = new Position();
                 parse_pos("position startpos\n", pos);
+                game_moves.clear();
+                game_moves_valid = true;
+                new_game();
+            } else if (!strncmp(line, "setoption", 9)) {
+                stop_search();
+                set_option(line);
             } else if (!strncmp(line, "go", 2)) {
-                //Do search
-                go(pos);
+                stop_search();
+                go(line, pos);
+            } else if (!strncmp(line, "bench", 5)) {
+                stop_search();
+                bench::run(line + 5);
+            } else if (!strncmp(line, "tbcheck", 7)) {
+                stop_search();
+                syzygy::check();
+            } else if (!strncmp(line, "perft", 5)) {
+                stop_search();
+                bench::run_perft(pos, atoi(line + 5));
             } else if (!strncmp(line, "quit", 4)) {
+                stop_search();
                 break;
             }
         }
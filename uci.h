@@ -14,6 +14,11 @@ namespace uci
 
     void send_hashtable_info(float percentage);
 
+#ifdef SEARCH_STATS
+    //Sends the statistics of the last iteration as info strings, last_iteration_nodes gives the branching factor
+    void send_search_stats(SearchResult *res, long int last_iteration_nodes);
+#endif
+
     void init();
 
     void loop();